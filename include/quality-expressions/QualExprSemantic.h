@@ -39,6 +39,7 @@ namespace quality_expressions_ns
     /* Destructor */  virtual	~QualExprSemantic(void) {}
 
     virtual bool			matchSemantic(unsigned int sem) const = 0;	//!< Return if the semantic match the given semantic ID.
+    virtual bool			semanticRange(unsigned int &first, unsigned int &last) const	{ return false; }	//!< Range [first, last[ of all the semantic IDs matched, false if unknown.
     virtual const char *		name(void) const = 0;				//!< The semantic name - shall be globally unique.
     virtual QualExprSemantic *		build(void) const = 0;
   };
@@ -49,6 +49,7 @@ namespace quality_expressions_ns
     /* Destructor */  virtual ~QualExprSemanticLocal(void) {}
 
     virtual const char *name(void) const	 { return ""; }
+    virtual bool	semanticRange(unsigned int &first, unsigned int &last) const	{ first = QE_PROFILER_LOCAL_BASE; last = QE_PROFILER_LOCAL_NOMORE; return true; }
   };
 
   /**
@@ -51,6 +51,7 @@ namespace quality_expressions_ns
     virtual bool			matchSemantic(unsigned int sem) const = 0;
     virtual const char *		name(void) const = 0;
     virtual enum qualexpr_event_papi_t	semantic(void) const = 0;
+    virtual bool			semanticRange(unsigned int &first, unsigned int &last) const	{ first = semantic(); last = first + 1; return true; }
   };
 
   /**
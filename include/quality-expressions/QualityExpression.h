@@ -55,6 +55,10 @@
    @endverbatim
    For more information see the document "PTF Quality Expression - Design
    Description" version 3 issued the 17/09/2014.
+
+   The mangled version is the canonical form of the parsed expression: no blanks, explicit
+   immediate aggregators, '>' and '>=' written as '<' and '<=', sorted operands of '+' and '*'
+   and parenthesized operands. Equivalent writings of an expression share the same mangling.
 */
 class QualityExpression: public std::string
 {
@@ -73,6 +77,10 @@ public:		// Class Definitions
 
   void 			display(const std::string &indent, std::stringstream &s) const;	//!< Display debugging information about the object.
 
+private:	// Mangling cache
+  mutable std::string	m_mangled;						//!< Last mangled expression.
+  mutable std::string	m_mangledSource;					//!< Expression the mangled version was computed from.
+
 #ifdef BOOST_SERIALIZATION
 private:	// Serialization API
   friend class boost::serialization::access;
@@ -29,19 +29,29 @@
  @{
 */
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+  struct profiling_event_t;
+
   void		QualExprDesk_globalInit(void);							//!< Global initialization.
   int		QualExprDesk_addCounter(unsigned long contextId, int metric, char *expression);	//!< Append a new quality expression indexed by a metric ID.
   long long	QualExprDesk_getLongCounter(unsigned long contextId, int metric);		//!< Get the value of a quality expression by a metric ID.
+  size_t	QualExprDesk_getCounters(unsigned long contextId, const int *metrics, long long *values, size_t count);	//!< Get the values of several quality expressions by metric IDs.
+  size_t	QualExprDesk_getAllCounters(unsigned long contextId, int *metrics, long long *values, size_t count);	//!< Get the metric IDs and values of all quality expressions of a contextId.
   int		QualExprDesk_resetCounter(unsigned long contextId, int metric);			//!< Reset the value of a quality expression by a metric ID.
   int		QualExprDesk_resetCounters(void);						//!< Reset to 0 all quality expression values.
   int		QualExprDesk_removeCounter(unsigned long contextId, int metric);		//!< Remove a quality expression from a contextId.
   int		QualExprDesk_removeCounters(void);						//!< Remove all quality expressions.
   int		QualExprDesk_startMeasures(void);						//!< Start measurements.
   int		QualExprDesk_stopMeasures(void);						//!< Stop measurements.
+  void		QualExprDesk_pushEvents(struct profiling_event_t *events, size_t count);		//!< Submit a batch of events generated at once.
+  int		QualExprDesk_setContext(unsigned long contextId);				//!< Route the events of the calling thread to a contextId.
+  int		QualExprDesk_clearContext(void);						//!< Send the events of the calling thread to all contextIds.
+  int		QualExprDesk_addGlobalContext(unsigned long contextId);				//!< Make a contextId receive the events of all contextIds.
 
 #ifdef __cplusplus
 }
@@ -55,6 +65,7 @@ extern "C" {
 
 #include "quality-expressions/QualityExpressions.h"
 #include "quality-expressions/QualityExpressionsProfiler.h"
+#include "quality-expressions/QualityExpressionsStatic.h"
 
 namespace quality_expressions_core {
   class QualExprManager;
@@ -86,12 +97,18 @@ public:	// Quality expression management API
   /* Destructor */ ~QualityExpressionsDesk(void) throw(Exception);
 
   size_t	addCounter(Context_t contextId, const QualityExpressionEntry &entry) throw(Exception);	//!< Append a quality expresion evaluation request.
+  size_t	addStaticCounter(Context_t contextId, QualityExpressionID_T id, qe::expression *expression) throw(Exception);	//!< Append a compiled quality expresion, owned by the desk.
+  template<class tree>
+  size_t	addStaticCounter(Context_t contextId, QualityExpressionID_T id) throw(Exception)	{ return addStaticCounter(contextId, id, new qe::expr<tree>()); }	//!< Append a quality expresion given as a type, @sa qe.
   long long	getLongCounter(Context_t contextId, QualityExpressionID_T id) throw(Exception);		//!< Retrieve the current quality expresion evaluation value.
+  size_t	getLongCounters(Context_t contextId, const QualityExpressionID_T *ids, long long *values, size_t count) throw(Exception);	//!< Retrieve the current values of several quality expresions.
+  size_t	getAllLongCounters(Context_t contextId, QualityExpressionID_T *ids, long long *values, size_t count) throw(Exception);	//!< Retrieve the IDs and current values of all quality expresions.
   void		resetCounter(Context_t contextId, QualityExpressionID_T id) throw(Exception);		//!< Reset the current quality expresion evaluation value.
   void		removeCounter(Context_t contextId, QualityExpressionID_T id) throw(Exception);		//!< Remove the quality expresion evaluation.
 
   void		resetCounters(void) throw(Exception);							//!< Reset all quality expresions to their neutral value.
   void		removeCounters(void) throw(Exception);							//!< Remove a given quality expresion.
+  void		addGlobalContext(Context_t contextId) throw(Exception);					//!< Make a context receive the events of all contexts.
 
   void		enableMeasures(void);									//!< Enable measurements.
   void		disableMeasures(void);									//!< Disable measurements.
@@ -101,6 +118,9 @@ public:	// Profiling system API
   bool		unregisterWithProfilers(void) throw(Exception);						//!< Remove this interface from registered event listeners in foreign profilers.
 
   void		event(profiling_event_t * event) throw();						//!< Event handling of foreign profilers.
+  void		events(profiling_event_t * events, size_t count) throw();				//!< Batch event handling of foreign profilers.
+  void		setActiveContext(Context_t contextId) throw();						//!< Route the events of the calling thread to a context.
+  void		clearActiveContext(void) throw();							//!< Send the events of the calling thread to all contexts.
 
 public:	// Static API
   static QualityExpressionsDesk *getGlobalManager(void) throw(Exception);			//!< Return the Desk descriptor unique application wide.
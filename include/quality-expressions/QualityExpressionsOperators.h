@@ -0,0 +1,68 @@
+/**
+   @file    QualityExpressionsOperators.h
+   @ingroup QualityExpressionEvaluation
+   @brief   Arithmetic operators of quality expressions
+   @author  Laurent Morin
+   @verbatim
+   Revision:       $Revision$
+   Revision date:  $Date$
+   Committed by:   $Author$
+
+   This file is part of the Periscope performance measurement tool.
+   See http://www.lrr.in.tum.de/periscope for details.
+
+   Copyright (c) 2005-2014, Technische Universitaet Muenchen, Germany
+   See the COPYING file in the base directory of the package for details.
+
+   @endverbatim
+*/
+
+#ifndef QUALITYEXPRESSIONS_OPERATORS_H_
+#define QUALITYEXPRESSIONS_OPERATORS_H_
+
+#include <string>
+#include <sstream>
+
+namespace quality_expressions_core
+{
+  /** @brief Instruction set of compute programs.
+      @ingroup QualityExpressionEvaluation
+  */
+  typedef enum compute_opcode_t {
+    OP_IMMEDIATE = 0,			//!< Immediate value.
+    OP_AGGREGATOR,			//!< Semantic aggregator evaluation.
+    OP_LIST,				//!< Binary operators, @sa BIN_OPERATOR.
+    OP_LT,
+    OP_GT,
+    OP_LE,
+    OP_GE,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV
+  } compute_opcode_t;
+
+  /** @def BIN_OPERATOR
+      @brief Define the arithmetic template of a binary operator with its opcode.
+      @ingroup QualityExpressionEvaluation
+  */
+#define BIN_OPERATOR( name, op, computation, show )                                                                         \
+  template<typename kind> class name {                                                                                      \
+  public:	enum { opcode = op };                                                                                       \
+  public:	static inline kind compute(kind a, kind b)					{ return computation ; }    \
+  public:	static inline void display(const std::string &indent, std::stringstream &s)	{ show; }                   \
+  };
+
+BIN_OPERATOR( list, OP_LIST, a,    s << ';' );
+BIN_OPERATOR( lt,   OP_LT,   a<b,  s << '<' );
+BIN_OPERATOR( gt,   OP_GT,   a>b,  s << '>' );
+BIN_OPERATOR( le,   OP_LE,   a<=b, s << "<=" );
+BIN_OPERATOR( ge,   OP_GE,   a>=b, s << ">=" );
+BIN_OPERATOR( add,  OP_ADD,  a+b,  s << '+' );
+BIN_OPERATOR( sub,  OP_SUB,  a-b,  s << '-' );
+BIN_OPERATOR( mul,  OP_MUL,  a*b,  s << '*' );
+BIN_OPERATOR( divi, OP_DIV,  b!=0 ? a/b : 0,  s << '/' );
+
+}
+
+#endif // QUALITYEXPRESSIONS_OPERATORS_H_
@@ -20,6 +20,8 @@
 #ifndef QUALITYEXPRESSION_PROFILER_H_
 #define QUALITYEXPRESSION_PROFILER_H_
 
+#include <stddef.h>
+
 /**
  * @defgroup QualityExpressionProfiler Quality expressions profiling
  * @ingroup QualityExpression
@@ -50,6 +52,7 @@ typedef struct profiling_event_t {
 } profiling_event_t;
 
 typedef void (*listen_event_func_t)(profiling_event_t *);	//!< Function type used to evaluate events generated by the profiler.
+typedef void (*listen_events_func_t)(profiling_event_t *, size_t);	//!< Function type used to evaluate a batch of events generated at once by the profiler.
 typedef void *semantic_namespace_t;				//!< Opaque type used to register a profiling namespace.
 
 /**@}*/
@@ -76,6 +76,8 @@ extern "C" {
 
   semantic_namespace_t qualExpr_papi_registerListener(listen_event_func_t listener);
   void qualExpr_papi_unregisterListener(listen_event_func_t listener);
+  semantic_namespace_t qualExpr_papi_registerBatchListener(listen_events_func_t listener);
+  void qualExpr_papi_unregisterBatchListener(listen_events_func_t listener);
 
   void qualExpr_papi_startCounters(void);
   void qualExpr_papi_stopCounters(void);
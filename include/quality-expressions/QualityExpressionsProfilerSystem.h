@@ -31,6 +31,15 @@
 template<typename type>
 static type atomic_add(type &var, type value)	{ return __sync_add_and_fetch(&var, value); }
 
+/**
+   @fn atomic_cas
+   @brief Interface for built-in atomic compare and swap operation.
+   @return true if the variable was holding the old value and has been updated.
+   @ingroup QualityExpressionProfilerInterface
+*/
+template<typename type>
+static bool atomic_cas(type &var, type oldValue, type newValue)	{ return __sync_bool_compare_and_swap(&var, oldValue, newValue); }
+
 /**
    @class QualExprSemaphore
    @brief Interface for standard semaphores.
@@ -0,0 +1,225 @@
+/**
+   @file    QualityExpressionsStatic.h
+   @ingroup QualityExpressionCore
+   @brief   Quality expressions defined at compile time
+   @author  Laurent Morin
+   @verbatim
+   Revision:       $Revision$
+   Revision date:  $Date$
+   Committed by:   $Author$
+
+   This file is part of the Periscope performance measurement tool.
+   See http://www.lrr.in.tum.de/periscope for details.
+
+   Copyright (c) 2005-2014, Technische Universitaet Muenchen, Germany
+   See the COPYING file in the base directory of the package for details.
+
+   @endverbatim
+*/
+
+#ifndef QUALITYEXPRESSIONS_STATIC_H_
+#define QUALITYEXPRESSIONS_STATIC_H_
+
+#include <stddef.h>
+#include <string>
+#include <sstream>
+
+#include "quality-expressions/QualityExpressionsOperators.h"
+
+namespace quality_expressions_core {
+  class QualExprSemanticAggregator;
+} // namespace quality_expressions_core
+
+/**
+   @brief Quality expressions written as C++ types.
+   @ingroup QualityExpressionCore
+
+   An expression known at build time is a type composed of immediates, aggregators and the binary
+   operators of the parser, e.g. the accumulated time of a region in micro seconds:
+   @code
+   typedef qe::div<qe::agg<qe::local::RegionExecution, qe::time_sum>, qe::imm<1000> > RegionTime;
+   desk->addStaticCounter<RegionTime>(contextId, id);
+   @endcode
+   The expression is registered without parsing, its aggregators are bound once and the operators
+   are inlined in a single evaluation function.
+*/
+namespace qe
+{
+  typedef long long						value_t;	//!< Type of the values computed.
+  typedef quality_expressions_core::QualExprSemanticAggregator	aggregator_t;	//!< Semantic aggregator, opaque outside the library.
+
+  /**
+     @class binder
+     @brief Interface used by the library to provide the aggregators of an expression.
+  */
+  class binder
+  {
+  public:
+    virtual aggregator_t &	aggregator(const char *eventName, const char *aggregName) = 0;	//!< Return the aggregator of an event, throw on error.
+  protected:
+    /* Destructor */ virtual	~binder(void) {}
+  };
+
+  /**
+     @class builder
+     @brief Interface used by the library to lower an expression in compute instructions.
+  */
+  class builder
+  {
+  public:
+    virtual size_t		pushImmediate(value_t value) = 0;				//!< Append an immediate, return its slot.
+    virtual size_t		pushAggregator(aggregator_t &aggreg) = 0;			//!< Append an aggregator evaluation, return its slot.
+    virtual size_t		pushOperation(int opcode, size_t lhs, size_t rhs) = 0;		//!< Append a binary operation, return its slot.
+  protected:
+    /* Destructor */ virtual	~builder(void) {}
+  };
+
+  value_t	evaluate(const aggregator_t &aggreg);				//!< Return the current value of an aggregator.
+  void		reset(aggregator_t &aggreg);					//!< Reset an aggregator.
+  void		display(const aggregator_t &aggreg, std::stringstream &s);	//!< Display an aggregator.
+
+  /**
+     @class expression
+     @brief Interface of the compiled expressions registered in the library.
+  */
+  class expression
+  {
+  public:
+    /* Destructor */ virtual	~expression(void) {}
+
+    virtual value_t		eval(void) const = 0;						//!< Compute the expression.
+    virtual void		reset(void) = 0;						//!< Reset the aggregators of the expression.
+    virtual void		display(std::stringstream &s) const = 0;			//!< Display the expression.
+    virtual void		bind(binder &b) = 0;						//!< Bind the aggregators of the expression.
+    virtual size_t		lower(builder &b) const = 0;					//!< Append the expression instructions, return the result slot.
+  };
+
+  /** @brief Expression node: immediate value. */
+  template<value_t value>
+  class imm
+  {
+  public:
+    value_t		eval(void) const				{ return value; }
+    void		reset(void)					{}
+    void		display(std::stringstream &s) const		{ s << value; }
+    void		bind(binder &)					{}
+    size_t		lower(builder &b) const				{ return b.pushImmediate(value); }
+  };
+
+  /** @brief Expression node: aggregator of an event, both given by a tag type with a static name(). */
+  template<class event, class aggregator>
+  class agg
+  {
+  public:
+    /* Constructor */	agg(void) : m_aggregator(NULL) {}
+
+    value_t		eval(void) const				{ return qe::evaluate(*m_aggregator); }
+    void		reset(void)					{ qe::reset(*m_aggregator); }
+    void		display(std::stringstream &s) const		{ qe::display(*m_aggregator, s); }
+    void		bind(binder &b)					{ m_aggregator = &b.aggregator(event::name(), aggregator::name()); }
+    size_t		lower(builder &b) const				{ return b.pushAggregator(*m_aggregator); }
+
+  private:
+    aggregator_t *	m_aggregator;					//!< Bound aggregator.
+  };
+
+  /** @brief Expression node: binary operator defined with BIN_OPERATOR. */
+  template<template<typename> class op, class lhs, class rhs>
+  class bin
+  {
+  public:
+    value_t		eval(void) const				{ return op<value_t>::compute(m_lhs.eval(), m_rhs.eval()); }
+    void		reset(void)					{ m_lhs.reset(); m_rhs.reset(); }
+    void		display(std::stringstream &s) const		{ s << '('; m_lhs.display(s); op<value_t>::display("", s); m_rhs.display(s); s << ')'; }
+    void		bind(binder &b)					{ m_lhs.bind(b); m_rhs.bind(b); }
+    size_t		lower(builder &b) const				{ size_t l = m_lhs.lower(b); size_t r = m_rhs.lower(b); return b.pushOperation(op<value_t>::opcode, l, r); }
+
+  private:
+    lhs			m_lhs;						//!< Left operand.
+    rhs			m_rhs;						//!< Right operand.
+  };
+
+  template<class lhs, class rhs> class list : public bin<quality_expressions_core::list, lhs, rhs> {};
+  template<class lhs, class rhs> class lt   : public bin<quality_expressions_core::lt,   lhs, rhs> {};
+  template<class lhs, class rhs> class gt   : public bin<quality_expressions_core::gt,   lhs, rhs> {};
+  template<class lhs, class rhs> class le   : public bin<quality_expressions_core::le,   lhs, rhs> {};
+  template<class lhs, class rhs> class ge   : public bin<quality_expressions_core::ge,   lhs, rhs> {};
+  template<class lhs, class rhs> class add  : public bin<quality_expressions_core::add,  lhs, rhs> {};
+  template<class lhs, class rhs> class sub  : public bin<quality_expressions_core::sub,  lhs, rhs> {};
+  template<class lhs, class rhs> class mul  : public bin<quality_expressions_core::mul,  lhs, rhs> {};
+  template<class lhs, class rhs> class div  : public bin<quality_expressions_core::divi, lhs, rhs> {};
+
+  /** @brief Compiled expression of a given expression type. */
+  template<class tree>
+  class expr : public expression
+  {
+  public:
+    virtual value_t	eval(void) const				{ return m_tree.eval(); }
+    virtual void	reset(void)					{ m_tree.reset(); }
+    virtual void	display(std::stringstream &s) const		{ m_tree.display(s); }
+    virtual void	bind(binder &b)					{ m_tree.bind(b); }
+    virtual size_t	lower(builder &b) const				{ return m_tree.lower(b); }
+
+  private:
+    tree		m_tree;						//!< Expression nodes.
+  };
+
+  /** @def QUALEXPR_STATIC_NAME
+      @brief Define a tag type naming an event or an aggregator.
+  */
+#define QUALEXPR_STATIC_NAME( tag, text )	struct tag { static const char *name(void) { return text; } }
+
+  QUALEXPR_STATIC_NAME( immediate,	"!" );
+  QUALEXPR_STATIC_NAME( time_sum,	"|time" );
+  QUALEXPR_STATIC_NAME( time_max,	"+time" );
+  QUALEXPR_STATIC_NAME( time_min,	"-time" );
+  QUALEXPR_STATIC_NAME( time_avg,	"~time" );
+  QUALEXPR_STATIC_NAME( time_p50,	"|p50" );
+  QUALEXPR_STATIC_NAME( time_p90,	"|p90" );
+  QUALEXPR_STATIC_NAME( time_p99,	"|p99" );
+  QUALEXPR_STATIC_NAME( time_p999,	"|p999" );
+  QUALEXPR_STATIC_NAME( time_var,	"|var" );
+  QUALEXPR_STATIC_NAME( time_stddev,	"|stddev" );
+  QUALEXPR_STATIC_NAME( time_sum_1s,	"|time-1s" );
+  QUALEXPR_STATIC_NAME( time_count_1s,	"|time-count-1s" );
+  QUALEXPR_STATIC_NAME( time_ewma_1s,	"~time-1s" );
+  QUALEXPR_STATIC_NAME( time_sum_10s,	"|time-10s" );
+  QUALEXPR_STATIC_NAME( time_count_10s,	"|time-count-10s" );
+  QUALEXPR_STATIC_NAME( time_ewma_10s,	"~time-10s" );
+  QUALEXPR_STATIC_NAME( time_sum_60s,	"|time-60s" );
+  QUALEXPR_STATIC_NAME( time_count_60s,	"|time-count-60s" );
+  QUALEXPR_STATIC_NAME( time_ewma_60s,	"~time-60s" );
+  QUALEXPR_STATIC_NAME( size_sum,	"|size" );
+  QUALEXPR_STATIC_NAME( size_max,	"+size" );
+  QUALEXPR_STATIC_NAME( size_min,	"-size" );
+  QUALEXPR_STATIC_NAME( size_avg,	"~size" );
+  QUALEXPR_STATIC_NAME( size_p50,	"|size-p50" );
+  QUALEXPR_STATIC_NAME( size_p90,	"|size-p90" );
+  QUALEXPR_STATIC_NAME( size_p99,	"|size-p99" );
+  QUALEXPR_STATIC_NAME( size_p999,	"|size-p999" );
+  QUALEXPR_STATIC_NAME( size_var,	"|size-var" );
+  QUALEXPR_STATIC_NAME( size_stddev,	"|size-stddev" );
+  QUALEXPR_STATIC_NAME( size_sum_1s,	"|size-1s" );
+  QUALEXPR_STATIC_NAME( size_count_1s,	"|size-count-1s" );
+  QUALEXPR_STATIC_NAME( size_ewma_1s,	"~size-1s" );
+  QUALEXPR_STATIC_NAME( size_sum_10s,	"|size-10s" );
+  QUALEXPR_STATIC_NAME( size_count_10s,	"|size-count-10s" );
+  QUALEXPR_STATIC_NAME( size_ewma_10s,	"~size-10s" );
+  QUALEXPR_STATIC_NAME( size_sum_60s,	"|size-60s" );
+  QUALEXPR_STATIC_NAME( size_count_60s,	"|size-count-60s" );
+  QUALEXPR_STATIC_NAME( size_ewma_60s,	"~size-60s" );
+  QUALEXPR_STATIC_NAME( bw_max,		"+bw" );
+  QUALEXPR_STATIC_NAME( bw_min,		"-bw" );
+  QUALEXPR_STATIC_NAME( bw_avg,		"~bw" );
+  QUALEXPR_STATIC_NAME( bw_var,		"|bw-var" );
+  QUALEXPR_STATIC_NAME( bw_stddev,	"|bw-stddev" );
+
+  /** @brief Events of the local profiler. */
+  namespace local {
+#define QUALEXPRSEMANTIC_LOCAL_DEF( DefName, matchSemanticExpression )	QUALEXPR_STATIC_NAME( DefName, "local::" #DefName );
+#include "quality-expressions/QualityExpressionsProfilerLocal.h"
+#undef QUALEXPRSEMANTIC_LOCAL_DEF
+  }
+}
+
+#endif // QUALITYEXPRESSIONS_STATIC_H_
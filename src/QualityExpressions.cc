@@ -18,6 +18,11 @@
 */
 #include <iostream>
 #include <sstream>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
 
 #include "quality-expressions/QualityExpressions.h"
 
@@ -25,15 +30,211 @@
 /* --------------------------------------------------------------------------------- */
 /* --------------------------------------------------------------------------------- */
 
+namespace {
+  /**
+     @class QualityExpressionMangler
+     @brief Recursive descent parser of the expression grammar producing the canonical form.
+     @ingroup QualityExpressionDataModel
+
+     The lexical rules and the operator precedences are the ones of the evaluator parser.
+  */
+  class QualityExpressionMangler
+  {
+  public:
+    /* Constructor */ QualityExpressionMangler(const std::string &expression) : m_expression(expression), m_cur(0) {}
+
+    bool		mangle(std::string &mangled);					//!< Compute the canonical form, false on syntax error.
+
+  private:
+    /** @brief Canonical form of a sub-expression. */
+    typedef struct term_t {
+      std::string		m_text;			//!< Canonical text.
+      char			m_op;			//!< Top operator, 0 for a leaf.
+      std::vector<std::string>	m_operands;		//!< Sorted operands of a commutative operator.
+    } term_t;
+
+    bool		list(std::string &mangled);
+    bool		compare(term_t &term);
+    bool		addSub(term_t &term);
+    bool		mulDiv(term_t &term);
+    bool		entry(term_t &term);
+    bool		event(term_t &term);
+
+    bool		token(const char *text);					//!< Consume a token.
+    bool		identifier(std::string &id);					//!< Consume an identifier.
+    void		skipBlanks(void);
+    static std::string	operand(const term_t &term)					{ return term.m_op ? '(' + term.m_text + ')' : term.m_text; }
+    static void		combine(term_t &lhs, const term_t &rhs, char op, const char *text);
+
+  private:
+    const std::string &	m_expression;		//!< Parsed expression.
+    size_t		m_cur;			//!< Parsing position.
+  };
+
+  bool QualityExpressionMangler::mangle(std::string &mangled)
+  {
+    skipBlanks();
+    if (m_cur == m_expression.size()) { mangled.clear(); return true; }
+    if (!list(mangled)) return false;
+    skipBlanks();
+    return m_cur == m_expression.size();
+  }
+
+  bool QualityExpressionMangler::list(std::string &mangled)
+  {
+    term_t term;
+    if (!compare(term)) return false;
+    mangled = term.m_text;
+    while (token(";")) {
+      if (!compare(term)) return false;
+      mangled += ';' + term.m_text;
+    }
+    return true;
+  }
+
+  bool QualityExpressionMangler::compare(term_t &term)
+  {
+    if (!addSub(term)) return false;
+    for (;;) {
+      term_t rhs;
+      if      (token("<=")) { if (!addSub(rhs)) return false; combine(term, rhs, 'l', "<="); }
+      else if (token(">=")) { if (!addSub(rhs)) return false; combine(rhs, term, 'l', "<="); term = rhs; }
+      else if (token("<"))  { if (!addSub(rhs)) return false; combine(term, rhs, '<', "<"); }
+      else if (token(">"))  { if (!addSub(rhs)) return false; combine(rhs, term, '<', "<"); term = rhs; }
+      else return true;
+    }
+  }
+
+  bool QualityExpressionMangler::addSub(term_t &term)
+  {
+    if (!mulDiv(term)) return false;
+    for (;;) {
+      term_t rhs;
+      if      (token("+")) { if (!mulDiv(rhs)) return false; combine(term, rhs, '+', "+"); }
+      else if (token("-")) { if (!mulDiv(rhs)) return false; combine(term, rhs, '-', "-"); }
+      else return true;
+    }
+  }
+
+  bool QualityExpressionMangler::mulDiv(term_t &term)
+  {
+    if (!entry(term)) return false;
+    for (;;) {
+      term_t rhs;
+      if      (token("*")) { if (!entry(rhs)) return false; combine(term, rhs, '*', "*"); }
+      else if (token("/")) { if (!entry(rhs)) return false; combine(term, rhs, '/', "/"); }
+      else return true;
+    }
+  }
+
+  bool QualityExpressionMangler::entry(term_t &term)
+  {
+    skipBlanks();
+    if (token("(")) return compare(term) && token(")");
+    if (m_cur < m_expression.size() && isdigit(m_expression[m_cur])) {
+      size_t first = m_cur;
+      while (m_cur < m_expression.size() && isdigit(m_expression[m_cur])) m_cur++;
+      std::stringstream s;
+      s << strtoll(m_expression.c_str() + first, NULL, 10);
+      term.m_text = s.str();
+      term.m_op = 0;
+      return true;
+    }
+    return event(term);
+  }
+
+  /** @brief Measure: the immediate aggregator is made explicit.
+   */
+  bool QualityExpressionMangler::event(term_t &term)
+  {
+    std::string name, space, aggreg;
+    if (!identifier(space) || !token(":") || !token(":") || !identifier(name)) return false;
+    if (!token(":"))		aggreg = "!";
+    else if (token("!"))	aggreg = "!";
+    else if (token("|"))	aggreg = "|";
+    else if (token("+"))	aggreg = "+";
+    else if (token("-"))	aggreg = "-";
+    else if (token("~"))	aggreg = "~";
+    else return false;
+    if (aggreg != "!") {
+      std::string attribute;
+      if (!identifier(attribute)) return false;
+      aggreg += attribute;
+    }
+    term.m_text = space + "::" + name + ':' + aggreg;
+    term.m_op = 0;
+    return true;
+  }
+
+  /** @brief Build the operation lhs op rhs in lhs. Operands of commutative operators are flattened and sorted.
+   */
+  void QualityExpressionMangler::combine(term_t &lhs, const term_t &rhs, char op, const char *text)
+  {
+    if (op == '+' || op == '*') {
+      std::vector<std::string> operands;
+      if (lhs.m_op == op) operands = lhs.m_operands; else operands.push_back(operand(lhs));
+      if (rhs.m_op == op) operands.insert(operands.end(), rhs.m_operands.begin(), rhs.m_operands.end());
+      else operands.push_back(operand(rhs));
+      std::sort(operands.begin(), operands.end());
+      lhs.m_text = operands[0];
+      for (size_t i = 1; i < operands.size(); i++) lhs.m_text += text + operands[i];
+      lhs.m_operands.swap(operands);
+    }
+    else {
+      lhs.m_text = operand(lhs) + text + operand(rhs);
+      lhs.m_operands.clear();
+    }
+    lhs.m_op = op;
+  }
+
+  bool QualityExpressionMangler::token(const char *text)
+  {
+    skipBlanks();
+    size_t size = strlen(text);
+    if (m_expression.compare(m_cur, size, text)) return false;
+    // A single '<', '>' or '=' is not the prefix of a two characters comparison token.
+    if (size == 1 && strchr("<>=", *text) && m_expression.compare(m_cur + 1, 1, "=") == 0) return false;
+    m_cur += size;
+    return true;
+  }
+
+  bool QualityExpressionMangler::identifier(std::string &id)
+  {
+    skipBlanks();
+    size_t first = m_cur;
+    if (m_cur == m_expression.size() || !(isalpha(m_expression[m_cur]) || m_expression[m_cur] == '_')) return false;
+    while (m_cur < m_expression.size() && (isalnum(m_expression[m_cur]) || m_expression[m_cur] == '_' || m_expression[m_cur] == '-')) m_cur++;
+    id.assign(m_expression, first, m_cur - first);
+    return true;
+  }
+
+  void QualityExpressionMangler::skipBlanks(void)
+  {
+    while (m_cur < m_expression.size() && isspace(m_expression[m_cur])) m_cur++;
+  }
+}
+
+/** @brief Return the canonical form of the expression.
+    An expression not following the grammar is returned unchanged, the error is reported when it is evaluated.
+*/
 const std::string & QualityExpression::mangle(void) const
 {
-  // TODO: Implement a real mangling
-  return (const std::string &) *this;
+  if (m_mangledSource != *this || m_mangled.empty()) {
+    QualityExpressionMangler mangler(*this);
+    if (!mangler.mangle(m_mangled)) m_mangled = *this;
+    m_mangledSource = *this;
+  }
+  return m_mangled;
 }
 
+/** @brief Set the expression from its canonical form.
+    @return false if the string is not a canonical expression, the expression is unchanged.
+*/
 bool QualityExpression::setMangledExpression(const std::string &mangled)
 {
-  // TODO: Implement a real unmangling
+  std::string canonical;
+  QualityExpressionMangler mangler(mangled);
+  if (!mangler.mangle(canonical) || canonical != mangled) return false;
   assign(mangled);
   return true;
 }
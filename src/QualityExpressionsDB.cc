@@ -86,7 +86,7 @@ void QualityExpressionDB::registerQualityExpression(const QualityExpression &exp
 void QualityExpressionDB::registerQualityExpressionEntry(const QualityExpression &expression, std::vector<QualityExpressionID_T> &p_idList)
 {
   QualityExpressionID_T result = 0;
-  QualityExpressionSet_T::iterator dbItem = m_qualityExpressionsSet.find(expression);
+  QualityExpressionSet_T::iterator dbItem = m_qualityExpressionsSet.find(expression.mangle());
   if (dbItem != m_qualityExpressionsSet.end()) {
     result = dbItem->second->id();
   }
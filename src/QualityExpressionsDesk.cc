@@ -71,6 +71,47 @@ extern "C" {
     return result;
   }
 
+  /** @brief Get the values of several quality expressions by metric IDs.
+      The context is resolved once for all metrics, the value of an unknown metric is set to 0.
+      @param metrics the metric IDs
+      @param values the values, one per metric ID
+      @param count the number of metric IDs
+      @return the number of values found
+  */
+  size_t QualExprDesk_getCounters(unsigned long contextId, const int *metrics, long long *values, size_t count)
+  {
+    size_t result = 0;
+    try {
+      QualityExpressionsDesk *desk = QualityExpressionsDesk::getGlobalManager();
+      result = desk->getLongCounters((QualityExpressionsDesk::Context_t) contextId, (const QualityExpressionID_T *) metrics, values, count);
+    }
+    catch(QualityExpressionsDesk::Exception e) {
+      fprintf(stderr, "Internal quality expression error: %s\n", e.what());
+      return 0;
+    }
+    return result;
+  }
+
+  /** @brief Get the metric IDs and values of all quality expressions of a context, in increasing ID order.
+      @param metrics the metric IDs
+      @param values the values, one per metric ID
+      @param count the size of the arrays, at most count metric IDs and values are written
+      @return the number of quality expressions of the context
+  */
+  size_t QualExprDesk_getAllCounters(unsigned long contextId, int *metrics, long long *values, size_t count)
+  {
+    size_t result = 0;
+    try {
+      QualityExpressionsDesk *desk = QualityExpressionsDesk::getGlobalManager();
+      result = desk->getAllLongCounters((QualityExpressionsDesk::Context_t) contextId, (QualityExpressionID_T *) metrics, values, count);
+    }
+    catch(QualityExpressionsDesk::Exception e) {
+      fprintf(stderr, "Internal quality expression error: %s\n", e.what());
+      return 0;
+    }
+    return result;
+  }
+
   /** @brief Reset the value of a quality expression by a metric ID.
       @param metric the metric ID to associated with the quality expression
   */
@@ -167,6 +208,73 @@ extern "C" {
     return 1;	// OK
   }
 
+  /** @brief Submit a batch of events generated at once.
+      The batch is evaluated in a single pass, all events share the same time stamp.
+      @param events the event array
+      @param count the number of events
+  */
+  void QualExprDesk_pushEvents(struct profiling_event_t *events, size_t count)
+  {
+    try {
+      QualityExpressionsDesk *desk = QualityExpressionsDesk::getGlobalManager();
+      desk->events(events, count);
+    }
+    catch(QualityExpressionsDesk::Exception e) {
+      fprintf(stderr, "Event error: %s\n", e.what());
+    }
+  }
+
+  /** @brief Route the events generated by the calling thread to one context.
+      Events are then only evaluated by this context and by the global contexts.
+      @param contextId the active context of the calling thread
+      @return 1 in case of success.
+  */
+  int QualExprDesk_setContext(unsigned long contextId)
+  {
+    try {
+      QualityExpressionsDesk *desk = QualityExpressionsDesk::getGlobalManager();
+      desk->setActiveContext((QualityExpressionsDesk::Context_t) contextId);
+    }
+    catch(QualityExpressionsDesk::Exception e) {
+      fprintf(stderr, "Internal quality expression error: %s\n", e.what());
+      return 0;
+    }
+    return 1;	// OK
+  }
+
+  /** @brief Send the events generated by the calling thread to all contexts.
+      @return 1 in case of success.
+  */
+  int QualExprDesk_clearContext(void)
+  {
+    try {
+      QualityExpressionsDesk *desk = QualityExpressionsDesk::getGlobalManager();
+      desk->clearActiveContext();
+    }
+    catch(QualityExpressionsDesk::Exception e) {
+      fprintf(stderr, "Internal quality expression error: %s\n", e.what());
+      return 0;
+    }
+    return 1;	// OK
+  }
+
+  /** @brief Make a context receive the events routed to any other context.
+      @param contextId the global context
+      @return 1 in case of success.
+  */
+  int QualExprDesk_addGlobalContext(unsigned long contextId)
+  {
+    try {
+      QualityExpressionsDesk *desk = QualityExpressionsDesk::getGlobalManager();
+      desk->addGlobalContext((QualityExpressionsDesk::Context_t) contextId);
+    }
+    catch(QualityExpressionsDesk::Exception e) {
+      fprintf(stderr, "Internal quality expression error: %s\n", e.what());
+      return 0;
+    }
+    return 1;	// OK
+  }
+
   /** @brief Private desk call-back function for profiling backend events.
       @param event the generated event.
   */
@@ -180,6 +288,17 @@ extern "C" {
       fprintf(stderr, "Event error: %s\n", e.what());
     }
   }
+
+#ifdef HAVE_PAPI
+  /** @brief Private desk call-back function for batches of profiling backend events.
+      @param events the generated events.
+      @param count the number of events.
+  */
+  static void launchEvents(profiling_event_t * events, size_t count)
+  {
+    QualExprDesk_pushEvents(events, count);
+  }
+#endif
 }
 
 /* ---------------------------------------------------------------------------------------------------------------- */
@@ -245,6 +364,24 @@ size_t QualityExpressionsDesk::addCounter(QualityExpressionsDesk::Context_t cont
   return rcount;
 }
 
+/** @brief Append a compiled quality expresion.
+    The expression is bound to the aggregators of the context without parsing.
+    The desk owns the expression, it is deleted if an exception is thrown.
+    @param contextId the context
+    @param id    the quality expresion ID
+    @param expression the compiled quality expresion
+    @return      the number of expression item registered
+*/
+size_t QualityExpressionsDesk::addStaticCounter(QualityExpressionsDesk::Context_t contextId, QualityExpressionID_T id, qe::expression *expression) throw(QualityExpressionsDesk::Exception)
+{
+  size_t rcount = 0;
+  try {
+    rcount = m_instance->addStaticCounter(contextId, id, expression);
+  }
+  catch(QualExprManager::Exception e) { throw(Exception(e.what())); }
+  return rcount;
+}
+
 /** @brief Get the result of a quality expresion evaluation.
     @param tid thread id
     @param id  the quality expresion ID
@@ -260,6 +397,40 @@ long long QualityExpressionsDesk::getLongCounter(QualityExpressionsDesk::Context
   return result;
 }
 
+/** @brief Get the results of several quality expresion evaluations.
+    @param contextId the context
+    @param ids    the quality expresion IDs
+    @param values the values, one per ID
+    @param count  the number of IDs
+    @return       the number of values found
+*/
+size_t QualityExpressionsDesk::getLongCounters(QualityExpressionsDesk::Context_t contextId, const QualityExpressionID_T *ids, long long *values, size_t count) throw(QualityExpressionsDesk::Exception)
+{
+  size_t result = 0;
+  try {
+    result = m_instance->getLongCounters(contextId, ids, values, count);
+  }
+  catch(QualExprManager::Exception e) { throw(Exception(e.what())); }
+  return result;
+}
+
+/** @brief Get the IDs and results of all the quality expresions of a context.
+    @param contextId the context
+    @param ids    the quality expresion IDs
+    @param values the values, one per ID
+    @param count  the size of the arrays
+    @return       the number of quality expresions of the context
+*/
+size_t QualityExpressionsDesk::getAllLongCounters(QualityExpressionsDesk::Context_t contextId, QualityExpressionID_T *ids, long long *values, size_t count) throw(QualityExpressionsDesk::Exception)
+{
+  size_t result = 0;
+  try {
+    result = m_instance->getAllLongCounters(contextId, ids, values, count);
+  }
+  catch(QualExprManager::Exception e) { throw(Exception(e.what())); }
+  return result;
+}
+
 /** @brief Reset the result of a quality expresion evaluation.
     @param tid thread id
     @param id  the quality expresion ID
@@ -309,6 +480,17 @@ void QualityExpressionsDesk::removeCounters(void) throw(QualityExpressionsDesk::
   catch(QualExprManager::Exception e) { throw(Exception(e.what())); }
 }
 
+/** @brief Make a context receive the events of all contexts.
+    @param contextId the global context
+*/
+void QualityExpressionsDesk::addGlobalContext(QualityExpressionsDesk::Context_t contextId) throw(QualityExpressionsDesk::Exception)
+{
+  try {
+    m_instance->addGlobalContext(contextId);
+  }
+  catch(QualExprManager::Exception e) { throw(Exception(e.what())); }
+}
+
 /** @brief Enable measurements.
     @param tid   thread id
 */
@@ -340,7 +522,7 @@ bool QualityExpressionsDesk::registerWithProfilers(void) throw(QualityExpression
   m_instance->registerSemanticNamespace(localNameSpace);
 
 #ifdef HAVE_PAPI
-  semantic_namespace_t papiNameSpace = qualExpr_papi_registerListener(launchEvent);
+  semantic_namespace_t papiNameSpace = qualExpr_papi_registerBatchListener(launchEvents);
   m_instance->registerSemanticNamespace(papiNameSpace);
 #endif
 
@@ -353,7 +535,7 @@ bool QualityExpressionsDesk::unregisterWithProfilers(void) throw(QualityExpressi
 {
   // ... un-register launchEvent ...
 #ifdef HAVE_PAPI
-  qualExpr_papi_unregisterListener(launchEvent);
+  qualExpr_papi_unregisterBatchListener(launchEvents);
 #endif
 
   qualExpr_unregisterListener(launchEvent);
@@ -364,3 +546,18 @@ void QualityExpressionsDesk::event(profiling_event_t * event) throw()
 {
   m_instance->event(event);
 }
+
+void QualityExpressionsDesk::events(profiling_event_t * events, size_t count) throw()
+{
+  m_instance->events(events, count);
+}
+
+void QualityExpressionsDesk::setActiveContext(QualityExpressionsDesk::Context_t contextId) throw()
+{
+  m_instance->setActiveContext(contextId);
+}
+
+void QualityExpressionsDesk::clearActiveContext(void) throw()
+{
+  m_instance->clearActiveContext();
+}
@@ -32,12 +32,38 @@ namespace quality_expressions_ns
    This class performs the management of local profiling metrics for all other modules.
    It is in charge also of interfacing the internal management of the local quality expressions semantic and namespace.
    This class is hidden from all other modules.
+
+   Event descriptors returned by startEvent() are taken from a slab owned by the calling thread, and event IDs
+   from a block of IDs reserved by the thread: starting and stopping an event neither allocates memory nor
+   touches shared data. A descriptor stopped by another thread is pushed without lock on the remote list of
+   its slab, drained by the owner before allocating new descriptors. Descriptors are never released to the
+   system, the slab of a terminated thread is adopted by the next new thread.
 */
-  class QualExprProfilerLocal // private QualExprSemaphore // LM -- Note: Use semaphores if the the atomic instrinsic is not supported for your machine.
+  class QualExprProfilerLocal : private QualExprSemaphore
   {
   public:
     typedef std::list<listen_event_func_t>	listenerList_T;
 
+    struct threadSlab_t;
+
+    /** @brief Event descriptor of the slab, the profiling event must remain the first member. */
+    typedef struct eventRecord_t {
+      struct profiling_event_t	m_event;		//!< Event handed over to the user.
+      struct eventRecord_t *	m_next;			//!< Next free descriptor.
+      struct threadSlab_t *	m_slab;			//!< Slab owning the descriptor.
+    } eventRecord_t;
+
+    /** @brief Event descriptors and event IDs owned by one thread. */
+    typedef struct threadSlab_t {
+      eventRecord_t *		m_free;			//!< Free descriptors.
+      eventRecord_t *		m_remote;		//!< Descriptors stopped by other threads, lock-free list.
+      unsigned int		m_eidNext;		//!< Last event ID given in the current block.
+      unsigned int		m_eidEnd;		//!< Last event ID of the current block.
+      struct threadSlab_t *	m_next;			//!< Next slab of terminated threads.
+    } threadSlab_t;
+
+    enum { SLAB_CHUNK = 64, EID_BLOCK = 1024 };		//!< Descriptors allocated at once, event IDs reserved at once.
+
   public:
     /* Destructor */ ~QualExprProfilerLocal(void) {}
 
@@ -51,14 +77,26 @@ namespace quality_expressions_ns
     static QualExprProfilerLocal *	getProfiler(void);
 
   private:
-    /* Constructor */ 			QualExprProfilerLocal(void) : m_eidCursor(0), m_listenerList() {}		//!< Constructor is only available via the getProfiler() method.
+    /* Constructor */ 			QualExprProfilerLocal(void);					//!< Constructor is only available via the getProfiler() method.
     void				propagateEvent(struct profiling_event_t * event);
+    threadSlab_t &			threadSlab(void);
+    static void				releaseSlab(void *slab);
 
-    unsigned int			m_eidCursor;			//!< Atomic counter for the generation of unique event IDs.
+    unsigned int			m_eidCursor;			//!< Atomic counter for the reservation of event ID blocks.
+    pthread_key_t			m_slabKey;			//!< Key used to recover the slab of terminated threads.
+    threadSlab_t *			m_orphanSlabs;			//!< Slabs of terminated threads, protected by the semaphore.
     listenerList_T			m_listenerList;			//!< The list of listeners for the profiler.
     QualExprSemanticNamespaceLocal	m_semanticNamespace;		//!< The quality expression namespace built for the local profiler.
   };
 
+  static __thread QualExprProfilerLocal::threadSlab_t *g_threadSlab = NULL;	//!< Slab of the calling thread.
+
+  /* Constructor */ QualExprProfilerLocal::QualExprProfilerLocal(void) :
+    QualExprSemaphore(), m_eidCursor(0), m_slabKey(), m_orphanSlabs(NULL), m_listenerList()
+  {
+    pthread_key_create(&m_slabKey, releaseSlab);
+  }
+
   /** @brief Return the Profiler descriptor that must be unique application wide.
    */
   QualExprProfilerLocal *QualExprProfilerLocal::getProfiler(void)
@@ -98,6 +136,40 @@ namespace quality_expressions_ns
     m_listenerList.remove(listener);
   }
 
+  /** @brief Return the slab of the calling thread, adopted or built on the first event of the thread.
+   */
+  QualExprProfilerLocal::threadSlab_t &QualExprProfilerLocal::threadSlab(void)
+  {
+    if (g_threadSlab) return *g_threadSlab;
+    lock();
+    threadSlab_t *slab = m_orphanSlabs;
+    if (slab) m_orphanSlabs = slab->m_next;
+    unlock();
+    if (!slab) {
+      slab = (threadSlab_t *) malloc(sizeof(threadSlab_t));
+      slab->m_free = slab->m_remote = NULL;
+      slab->m_eidNext = slab->m_eidEnd = 0;
+    }
+    slab->m_next = NULL;
+    pthread_setspecific(m_slabKey, slab);
+    g_threadSlab = slab;
+    return *slab;
+  }
+
+  /** @brief Thread termination: the slab is kept for the next new thread.
+      Descriptors still started by the terminated thread remain valid.
+   */
+  void QualExprProfilerLocal::releaseSlab(void *slab)
+  {
+    QualExprProfilerLocal *profiler = getProfiler();
+    threadSlab_t *orphan = (threadSlab_t *) slab;
+    profiler->lock();
+    orphan->m_next = profiler->m_orphanSlabs;
+    profiler->m_orphanSlabs = orphan;
+    profiler->unlock();
+    g_threadSlab = NULL;
+  }
+
   /** @brief Generate an event "start" with the given semantic.
       @param semantic the event semantic in the list of semantic available for the local profiler (@sa qualexpr_event_local_t)
       @param value the event value, meaning depending on the event semantic
@@ -105,15 +177,34 @@ namespace quality_expressions_ns
    */
   struct profiling_event_t * QualExprProfilerLocal::startEvent(enum qualexpr_event_local_t semantic, long long value)
   {
-    unsigned int eid = atomic_add<unsigned int> (m_eidCursor, 1);
-    struct profiling_event_t event = { D_START, semantic, eid, value };
-    struct profiling_event_t *currentEvent = (struct profiling_event_t *) malloc(sizeof(struct profiling_event_t));
-    *currentEvent = event;
-    propagateEvent(currentEvent);
-    return currentEvent;
+    threadSlab_t &slab = threadSlab();
+    if (slab.m_eidNext == slab.m_eidEnd) {
+      slab.m_eidEnd = atomic_add<unsigned int> (m_eidCursor, EID_BLOCK);
+      slab.m_eidNext = slab.m_eidEnd - EID_BLOCK;
+    }
+    while (!slab.m_free && slab.m_remote) {
+      eventRecord_t *remote = slab.m_remote;
+      if (atomic_cas<eventRecord_t *>(slab.m_remote, remote, NULL)) slab.m_free = remote;
+    }
+    if (!slab.m_free) {
+      eventRecord_t *chunk = (eventRecord_t *) malloc(SLAB_CHUNK * sizeof(eventRecord_t));
+      for (size_t index = 0; index < SLAB_CHUNK; index++) {
+        chunk[index].m_next = (index + 1 < SLAB_CHUNK) ? &chunk[index + 1] : NULL;
+        chunk[index].m_slab = &slab;
+      }
+      slab.m_free = chunk;
+    }
+    eventRecord_t *record = slab.m_free;
+    slab.m_free = record->m_next;
+
+    struct profiling_event_t event = { D_START, semantic, ++slab.m_eidNext, value };
+    record->m_event = event;
+    propagateEvent(&record->m_event);
+    return &record->m_event;
   }
 
   /** @brief Generate an event "stop" with the given semantic.
+      The descriptor is given back to its slab, through the remote list when stopped by another thread.
       @param eventStarted the event descriptor generated for the associated "start" event.
       @param value the event value, meaning depending on the event semantic
    */
@@ -122,7 +213,15 @@ namespace quality_expressions_ns
     struct profiling_event_t event = { D_STOP, eventStarted->m_semanticId, eventStarted->m_eid, eventStarted->m_value + value };
     *eventStarted = event;
     propagateEvent(eventStarted);
-    free(eventStarted);
+
+    eventRecord_t *record = (eventRecord_t *) eventStarted;
+    threadSlab_t *slab = record->m_slab;
+    if (slab == g_threadSlab) {
+      record->m_next = slab->m_free;
+      slab->m_free = record;
+    } else {
+      do { record->m_next = slab->m_remote; } while (!atomic_cas(slab->m_remote, record->m_next, record));
+    }
   }
 
   extern "C" {
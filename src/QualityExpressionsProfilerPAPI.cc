@@ -55,6 +55,7 @@ namespace quality_expressions_ns
   {
   public:
     typedef std::list<listen_event_func_t>	listenerList_T;
+    typedef std::list<listen_events_func_t>	batchListenerList_T;
     typedef long long				long64_papi_t;
 
     /**
@@ -75,6 +76,8 @@ namespace quality_expressions_ns
   public:	// -- Global Event Management API 
     const QualExprSemanticNamespace	&registerListener(listen_event_func_t listener);
     void				unregisterListener(listen_event_func_t listener);
+    const QualExprSemanticNamespace	&registerBatchListener(listen_events_func_t listener);
+    void				unregisterBatchListener(listen_events_func_t listener);
 
     static QualExprProfilerPapi *	getProfiler(void);
 
@@ -89,6 +92,7 @@ namespace quality_expressions_ns
   private:
     /* Constructor */ 			QualExprProfilerPapi(void);		//!< Constructor is only available via the getProfiler() method.
     void				propagateEvent(struct profiling_event_t * event);
+    void				propagateEvents(struct profiling_event_t * events, size_t count);
     long64_papi_t			getInfo(enum qualexpr_event_papi_t semantic) throw (QualExprProfilerPapi::Exception);
 
   private:	// -- PAPI util functions.
@@ -100,16 +104,19 @@ namespace quality_expressions_ns
     PAPI_hw_info_t			 	m_papi_hardware_info;		//!< PAPI machine description descriptor.
     unsigned int				m_eidCursor;			//!< Atomic counter for the generation of unique event IDs.
     listenerList_T				m_listenerList;			//!< The list of listeners for the profiler.
+    batchListenerList_T				m_batchListenerList;		//!< The list of batch listeners for the profiler.
     QualExprSemanticNamespacePAPI *		m_semanticNamespace;		//!< The quality expression namespace built for the PAPI profiler.
     std::vector<enum qualexpr_event_papi_t>	m_counterList;			//!< The list of counters active in the PAPI event set.
     std::vector<enum qualexpr_event_papi_t>	m_infoList;			//!< The list of active static PAPI metrics extracted from the hardware info descriptor.
+    std::vector<long64_papi_t>			m_counterValues;		//!< Counter values read when stopping, one per active counter.
+    std::vector<struct profiling_event_t>	m_counterEvents;		//!< Events generated when stopping, one per active counter.
   };
 
   /** @brief PAPI Profiler constructor
       The QualExprProfilerPapi class initialization is in charge of operating the necessary initialization of the PAPI library.
       A PAPI event set - the descriptor holding all active PAPI counters - and the machine description descriptor are also created for future usage.
    */
-  /* Constructor */ QualExprProfilerPapi::QualExprProfilerPapi(void) : QualExprSemaphore(), m_papiEventSet(PAPI_NULL), m_eidCursor(0), m_listenerList(), m_semanticNamespace(NULL)
+  /* Constructor */ QualExprProfilerPapi::QualExprProfilerPapi(void) : QualExprSemaphore(), m_papiEventSet(PAPI_NULL), m_eidCursor(0), m_listenerList(), m_batchListenerList(), m_semanticNamespace(NULL)
   {
     int initDone = PAPI_is_initialized();
     if (initDone == PAPI_NOT_INITED) {
@@ -155,6 +162,21 @@ namespace quality_expressions_ns
     }
   }
 
+  /** @brief Propate a batch of events to all listeners.
+      Batch listeners receive the batch at once, other listeners receive the events one by one.
+      @param currentEvents the events to propate
+      @param count the number of events
+   */
+  void QualExprProfilerPapi::propagateEvents(struct profiling_event_t * currentEvents, size_t count)
+  {
+    for (batchListenerList_T::const_iterator ite = m_batchListenerList.begin(); ite != m_batchListenerList.end(); ite++) {
+      (*ite)(currentEvents, count);
+    }
+    for (size_t index = 0; index < count && !m_listenerList.empty(); index++) {
+      propagateEvent(currentEvents + index);
+    }
+  }
+
   /** @brief Register a listener for all events generated by this profiling manager.
       @param listener the callback that will be used to propagate events to that listener.
       @return the semantic namespace for the PAPI profiler.
@@ -174,6 +196,25 @@ namespace quality_expressions_ns
     m_listenerList.remove(listener);
   }
 
+  /** @brief Register a batch listener for all events generated by this profiling manager.
+      @param listener the callback that will be used to propagate batches of events to that listener.
+      @return the semantic namespace for the PAPI profiler.
+   */
+  const QualExprSemanticNamespace &QualExprProfilerPapi::registerBatchListener(listen_events_func_t listener)
+  {
+    m_batchListenerList.push_back(listener);
+    if (!m_semanticNamespace) m_semanticNamespace = new QualExprSemanticNamespacePAPI;
+    return *m_semanticNamespace;
+  }
+
+  /** @brief Unregister a batch listener.
+      @param listener the callback to be removed
+   */
+  void QualExprProfilerPapi::unregisterBatchListener(listen_events_func_t listener)
+  {
+    m_batchListenerList.remove(listener);
+  }
+
   /** @brief Check and process a PAPI error.
       @param message the error message
       @param retVal the error code to check
@@ -309,7 +350,10 @@ namespace quality_expressions_ns
         found = (m_counterList[index] == semantic);
       }
       if (!found) {
+        struct profiling_event_t event = { D_COUNTER, semantic };
         m_counterList.push_back(semantic);
+        m_counterValues.push_back(0);
+        m_counterEvents.push_back(event);
         err = PAPI_add_event(m_papiEventSet, papi_counter);
       }
       unlock();
@@ -332,6 +376,8 @@ namespace quality_expressions_ns
     m_infoList.clear();
     if (!m_counterList.empty()) {
       m_counterList.clear();
+      m_counterValues.clear();
+      m_counterEvents.clear();
       err = PAPI_reset(m_papiEventSet);
     }
     unlock();
@@ -364,29 +410,25 @@ namespace quality_expressions_ns
   }
 
   /** @brief Stop the active PAPI counters and generate an event for all counters and metrics
-      The event value is set with the current counter value.
+      The event value is set with the current counter value. The values and the events are stored in
+      buffers sized when the counters are added, the batch is propagated under the profiler lock.
    */
   void QualExprProfilerPapi::stopCounters(void)
   {
     if (!m_counterList.empty()) {
-      long64_papi_t *values = (long64_papi_t *) malloc(sizeof(long64_papi_t) * m_counterList.size());
       lock();
-      int err = PAPI_stop(m_papiEventSet, values);
-      if (err != PAPI_OK) processError("Failed starting PAPI counter", err);
-      unlock();
-
-      struct profiling_event_t event = { D_COUNTER, QE_PROFILER_PAPI_BASE };
-      struct profiling_event_t *currentEvent = (struct profiling_event_t *) malloc(sizeof(struct profiling_event_t));
-      *currentEvent = event;
-      for (size_t index = 0; index < m_counterList.size(); index++) {
-        unsigned int eid = atomic_add<unsigned int> (m_eidCursor, 1);
-        currentEvent->m_eid = eid;
-        currentEvent->m_semanticId = m_counterList[index];
-        currentEvent->m_value = (long long) values[index];
-        propagateEvent(currentEvent);
+      int err = PAPI_stop(m_papiEventSet, &m_counterValues[0]);
+      if (err == PAPI_OK) {
+        size_t count = m_counterEvents.size();
+        unsigned int eid = atomic_add<unsigned int> (m_eidCursor, count) - count;
+        for (size_t index = 0; index < count; index++) {
+          m_counterEvents[index].m_eid = ++eid;
+          m_counterEvents[index].m_value = (long long) m_counterValues[index];
+        }
+        propagateEvents(&m_counterEvents[0], count);
       }
-      free(currentEvent);
-      free(values);
+      unlock();
+      if (err != PAPI_OK) processError("Failed stopping PAPI counter", err);
     }
   }
 
@@ -401,6 +443,16 @@ namespace quality_expressions_ns
       QualExprProfilerPapi::getProfiler()->unregisterListener(listener);
     }
 
+    semantic_namespace_t qualExpr_papi_registerBatchListener(listen_events_func_t listener)
+    {
+      return (semantic_namespace_t) &QualExprProfilerPapi::getProfiler()->registerBatchListener(listener);
+    }
+
+    void qualExpr_papi_unregisterBatchListener(listen_events_func_t listener)
+    {
+      QualExprProfilerPapi::getProfiler()->unregisterBatchListener(listener);
+    }
+
     void qualExpr_papi_startCounters(void)
     {
       try {
@@ -475,7 +527,14 @@ namespace quality_expressions_ns
       return (semantic_namespace_t) g_semanticNamespace;
     }
 
+    semantic_namespace_t qualExpr_papi_registerBatchListener(listen_events_func_t listener)
+    {
+      if (!g_semanticNamespace) g_semanticNamespace = new QualExprSemanticNamespacePAPI;
+      return (semantic_namespace_t) g_semanticNamespace;
+    }
+
     void qualExpr_papi_unregisterListener(listen_event_func_t listener)				{ qualExpr_papi_nopapierror(); }
+    void qualExpr_papi_unregisterBatchListener(listen_events_func_t listener)			{ qualExpr_papi_nopapierror(); }
     void qualExpr_papi_startCounters(void)							{ qualExpr_papi_nopapierror(); }
     void qualExpr_papi_stopCounters(void)							{ qualExpr_papi_nopapierror(); }
     enum qualexpr_kind_papi_t qualExpr_papi_eventKind(enum qualexpr_event_papi_t semantic)	{ qualExpr_papi_nopapierror(); return PAPI_KIND_UNDEF; }
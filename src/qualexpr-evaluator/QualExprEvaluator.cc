@@ -22,6 +22,10 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <math.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "qualexpr-evaluator/QualExprEvaluator.h"
 #include "qualexpr-evaluator/QualExprEvaluatorParserDriver.h"
@@ -46,7 +50,8 @@ namespace quality_expressions_core
   {
     for (size_t index=0; index < m_aggregatorList.size(); index++) {
       const QualExprAggregator *aggreg = m_aggregatorList[index];
-      if (aggreg->name() == aggregatorName) return aggreg->build(id);
+      QualExprAggregator *newAggreg = aggreg->buildFromName(aggregatorName, id);
+      if (newAggreg) return newAggreg;
     }
     return NULL;
   }
@@ -70,10 +75,182 @@ namespace quality_expressions_core
   /* ---------------------------------------------------------------------------------------------------------------- */
   /* ---------------------------------------------------------------------------------------------------------------- */
 
+  void QualExprOpenIntervals::open(unsigned int eid, qualexpr_time_t timestamp, long long value)
+  {
+    if (!m_entries) resize(MIN_SIZE);
+    else if ((m_count + 1) * 4 > m_size * 3) {
+      if (m_size < MAX_SIZE) resize(m_size * 2);
+      else evictOldest();
+    }
+    size_t index = slot(eid);
+    while (m_entries[index].m_used && m_entries[index].m_eid != eid) index = (index + 1) & (m_size - 1);
+    if (!m_entries[index].m_used) m_count ++;
+    entry_t &entry = m_entries[index];
+    entry.m_eid = eid;
+    entry.m_used = true;
+    entry.m_timestamp = timestamp;
+    entry.m_value = value;
+  }
+
+  bool QualExprOpenIntervals::close(unsigned int eid, qualexpr_time_t &timestamp, long long &value)
+  {
+    if (!m_count) return false;
+    for (size_t index = slot(eid); m_entries[index].m_used; index = (index + 1) & (m_size - 1)) {
+      if (m_entries[index].m_eid == eid) {
+        timestamp = m_entries[index].m_timestamp;
+        value = m_entries[index].m_value;
+        erase(index);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void QualExprOpenIntervals::resize(size_t size)
+  {
+    entry_t *oldEntries = m_entries;
+    size_t oldSize = m_size;
+    m_entries = (entry_t *) calloc(size, sizeof(entry_t));
+    m_size = size;
+    for (size_t index = 0; index < oldSize; index++) {
+      if (!oldEntries[index].m_used) continue;
+      size_t newIndex = slot(oldEntries[index].m_eid);
+      while (m_entries[newIndex].m_used) newIndex = (newIndex + 1) & (m_size - 1);
+      m_entries[newIndex] = oldEntries[index];
+    }
+    free(oldEntries);
+  }
+
+  /** @brief Remove an entry, following entries of the probe sequence are moved back into the hole.
+   */
+  void QualExprOpenIntervals::erase(size_t index)
+  {
+    size_t mask = m_size - 1;
+    size_t hole = index;
+    for (size_t next = (hole + 1) & mask; m_entries[next].m_used; next = (next + 1) & mask) {
+      size_t home = slot(m_entries[next].m_eid);
+      if (((next - home) & mask) >= ((next - hole) & mask)) {
+        m_entries[hole] = m_entries[next];
+        hole = next;
+      }
+    }
+    m_entries[hole].m_used = false;
+    m_count --;
+  }
+
+  void QualExprOpenIntervals::evictOldest(void)
+  {
+    size_t oldest = m_size;
+    for (size_t index = 0; index < m_size; index++) {
+      if (m_entries[index].m_used && (oldest == m_size || m_entries[index].m_timestamp < m_entries[oldest].m_timestamp)) oldest = index;
+    }
+    if (oldest < m_size) erase(oldest);
+  }
+
+  /** @brief Allocate the tables once, a concurrent allocation from another replica is dropped.
+   */
+  QualExprSharedIntervals::stripe_t * QualExprSharedIntervals::stripes(void) const
+  {
+    if (!m_stripes) {
+      stripe_t *stripes = new stripe_t[STRIPES];
+      if (!atomic_cas<stripe_t *>(m_stripes, NULL, stripes)) delete [] stripes;
+    }
+    return m_stripes;
+  }
+
+  void QualExprSharedIntervals::open(unsigned int eid, qualexpr_time_t timestamp, long long value)
+  {
+    stripe_t &current = stripe(eid);
+    current.m_lock.lock();
+    current.m_intervals.open(eid, timestamp, value);
+    current.m_lock.unlock();
+  }
+
+  bool QualExprSharedIntervals::close(unsigned int eid, qualexpr_time_t &timestamp, long long &value)
+  {
+    stripe_t &current = stripe(eid);
+    current.m_lock.lock();
+    bool found = current.m_intervals.close(eid, timestamp, value);
+    current.m_lock.unlock();
+    return found;
+  }
+
+  /* ---------------------------------------------------------------------------------------------------------------- */
+
+  /* Constructor */ QualExprLanes::QualExprLanes(size_t size) :
+    m_counts((size_t *) calloc(size + 1, sizeof(size_t))), m_values((long long *) calloc(size + 1, sizeof(long long))),
+    m_versions((unsigned long *) calloc(size + 1, sizeof(unsigned long)))
+  {}
+
+  /* Destructor */ QualExprLanes::~QualExprLanes(void)
+  {
+    free(m_counts);
+    free(m_values);
+    free(m_versions);
+  }
+
+  /** @brief Accumulate the samples of a run of events in the lanes [begin, end[.
+      The samples are reduced once, then applied to all lanes, as the events would be one by one. A
+      minimum starts again from a negative value, so negative samples are applied one by one.
+      @param samples the values sampled from the run
+      @param count the number of samples
+      @param events the number of events of the run, added to the versions
+  */
+  void QualExprLanes::accumulate(QualExprAggregator::lane_t lane, size_t begin, size_t end, const long long *samples, size_t count, size_t events)
+  {
+    for (size_t index = begin; index < end; index++) {
+      m_counts[index] += count;
+      m_versions[index] += events;
+    }
+    if (!count) return;
+
+    long long sum = 0, max = samples[0], min = samples[0];
+    for (size_t index = 0; index < count; index++) {
+      sum += samples[index];
+      max = samples[index] > max ? samples[index] : max;
+      min = samples[index] < min ? samples[index] : min;
+    }
+    switch (lane) {
+    case QualExprAggregator::LANE_SUM:
+      for (size_t index = begin; index < end; index++) m_values[index] += sum;
+      break;
+    case QualExprAggregator::LANE_MAX:
+      for (size_t index = begin; index < end; index++) m_values[index] = m_values[index] < max ? max : m_values[index];
+      break;
+    case QualExprAggregator::LANE_MIN:
+      if (min >= 0) {
+        for (size_t index = begin; index < end; index++) m_values[index] = (m_values[index] < 0 || m_values[index] > min) ? min : m_values[index];
+      }
+      else for (size_t index = begin; index < end; index++) {
+        for (size_t sample = 0; sample < count; sample++) {
+          if (m_values[index] < 0 || m_values[index] > samples[sample]) m_values[index] = samples[sample];
+        }
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+
   void QualExprAggregatorImmediate::processEvent(const QualExprEvent &event)
   {
     if (event.m_state == D_COUNTER) {
       m_value = event.m_value;
+      m_timestamp = event.m_timestamp;
+    }
+  }
+
+  void QualExprAggregatorImmediate::merge(const QualExprAggregator &replica)
+  {
+    const QualExprAggregatorImmediate &immediate = static_cast<const QualExprAggregatorImmediate &>(replica);
+    if (immediate.m_timestamp > m_timestamp) {
+      m_value = immediate.m_value;
+      m_timestamp = immediate.m_timestamp;
     }
   }
 
@@ -87,91 +264,342 @@ namespace quality_expressions_core
   /* ---------------------------------------------------------------------------------------------------------------- */
   /* ---------------------------------------------------------------------------------------------------------------- */
 
+  void QualExprHistogram::merge(const QualExprHistogram &replica)
+  {
+    if (!replica.m_count) return;
+    if (!m_count || replica.m_min < m_min) m_min = replica.m_min;
+    if (!m_count || replica.m_max > m_max) m_max = replica.m_max;
+    for (size_t index = 0; index < BUCKETS; index++) m_buckets[index] += replica.m_buckets[index];
+    m_count += replica.m_count;
+  }
+
+  /** @brief Pairwise combination of two series: the mean is weighted by the counts, the squared distances
+      are corrected by the distance between the two means.
+  */
+  void QualExprMoments::merge(const QualExprMoments &replica)
+  {
+    if (!replica.m_count) return;
+    if (!m_count) { *this = replica; return; }
+    size_t count = m_count + replica.m_count;
+    double delta = replica.m_mean - m_mean;
+    m_mean += delta * replica.m_count / count;
+    m_m2 += replica.m_m2 + delta * delta * ((double) m_count * replica.m_count / count);
+    m_count = count;
+  }
+
+  double QualExprMoments::stddev(void) const
+  {
+    return sqrt(variance());
+  }
+
+  void QualExprSlidingWindow::reset(void)
+  {
+    m_last = 0;
+    for (size_t index = 0; index < SLOTS; index++) {
+      m_slots[index].m_slice = 0;
+      m_slots[index].m_sum = 0;
+      m_slots[index].m_count = 0;
+    }
+  }
+
+  /** @brief Record a value in the slot of its time slice, values older than the window are ignored.
+   */
+  void QualExprSlidingWindow::record(qualexpr_time_t timestamp, long long value)
+  {
+    qualexpr_time_t slice = timestamp > 0 ? timestamp / m_width : 0;
+    if (slice + SLOTS <= m_last) return;
+    slot_t &slot = m_slots[slice % SLOTS];
+    if (slot.m_slice != slice) {
+      slot.m_slice = slice;
+      slot.m_sum = 0;
+      slot.m_count = 0;
+    }
+    slot.m_sum += value;
+    slot.m_count++;
+    if (slice > m_last) m_last = slice;
+  }
+
+  /** @brief Slots of the same slice are added, otherwise the most recent slice is kept.
+   */
+  void QualExprSlidingWindow::merge(const QualExprSlidingWindow &replica)
+  {
+    for (size_t index = 0; index < SLOTS; index++) {
+      const slot_t &other = replica.m_slots[index];
+      slot_t &slot = m_slots[index];
+      if (!other.m_count) continue;
+      if (!slot.m_count || slot.m_slice < other.m_slice) slot = other;
+      else if (slot.m_slice == other.m_slice) {
+        slot.m_sum += other.m_sum;
+        slot.m_count += other.m_count;
+      }
+    }
+    if (replica.m_last > m_last) m_last = replica.m_last;
+  }
+
+  long long QualExprSlidingWindow::sum(void) const
+  {
+    long long sum = 0;
+    for (size_t index = 0; index < SLOTS; index++) if (current(m_slots[index])) sum += m_slots[index].m_sum;
+    return sum;
+  }
+
+  long long QualExprSlidingWindow::count(void) const
+  {
+    long long count = 0;
+    for (size_t index = 0; index < SLOTS; index++) if (current(m_slots[index])) count += m_slots[index].m_count;
+    return count;
+  }
+
+  double QualExprDecayedAverage::decay(qualexpr_time_t age) const
+  {
+    return exp(- (double) age / m_period);
+  }
+
+  /** @brief Age the state to the time of the value, a late value is aged to the time of the state instead.
+   */
+  void QualExprDecayedAverage::record(qualexpr_time_t timestamp, long long value)
+  {
+    if (timestamp >= m_last) {
+      double weight = decay(timestamp - m_last);
+      m_sum = m_sum * weight + value;
+      m_weight = m_weight * weight + 1;
+      m_last = timestamp;
+    }
+    else {
+      double weight = decay(m_last - timestamp);
+      m_sum += value * weight;
+      m_weight += weight;
+    }
+  }
+
+  void QualExprDecayedAverage::merge(const QualExprDecayedAverage &replica)
+  {
+    if (replica.m_weight <= 0) return;
+    if (m_weight <= 0) { *this = replica; return; }
+    if (replica.m_last > m_last) {
+      double weight = decay(replica.m_last - m_last);
+      m_sum = m_sum * weight + replica.m_sum;
+      m_weight = m_weight * weight + replica.m_weight;
+      m_last = replica.m_last;
+    }
+    else {
+      double weight = decay(m_last - replica.m_last);
+      m_sum += replica.m_sum * weight;
+      m_weight += replica.m_weight * weight;
+    }
+  }
+
+  void QualExprCountMinSketch::reset(void)
+  {
+    for (size_t row = 0; row < DEPTH; row++) {
+      for (size_t column = 0; column < WIDTH; column++) m_cells[row][column] = 0;
+    }
+    m_topSize = 0;
+  }
+
+  /** @brief Hash a value with a different seed per row.
+   */
+  size_t QualExprCountMinSketch::cell(size_t row, long long value)
+  {
+    unsigned long long hash = (unsigned long long) value + (row + 1) * 0x9E3779B97F4A7C15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+    return (size_t) ((hash ^ (hash >> 31)) % WIDTH);
+  }
+
+  void QualExprCountMinSketch::record(long long value)
+  {
+    size_t count = 0;
+    for (size_t row = 0; row < DEPTH; row++) {
+      unsigned int &counter = m_cells[row][cell(row, value)];
+      counter++;
+      if (!row || counter < count) count = counter;
+    }
+    offer(value, count);
+  }
+
+  size_t QualExprCountMinSketch::estimate(long long value) const
+  {
+    size_t count = 0;
+    for (size_t row = 0; row < DEPTH; row++) {
+      size_t counter = m_cells[row][cell(row, value)];
+      if (!row || counter < count) count = counter;
+    }
+    return count;
+  }
+
+  /** @brief Record the estimate of a value in the list of frequent values.
+      A value not in the full list replaces the value of lowest estimate if its estimate is higher.
+  */
+  void QualExprCountMinSketch::offer(long long value, size_t count)
+  {
+    size_t lowest = 0;
+    for (size_t index = 0; index < m_topSize; index++) {
+      if (m_top[index].m_value == value) { m_top[index].m_count = count; return; }
+      if (m_top[index].m_count < m_top[lowest].m_count) lowest = index;
+    }
+    if (m_topSize < TOP) lowest = m_topSize++;
+    else if (m_top[lowest].m_count >= count) return;
+    m_top[lowest].m_value = value;
+    m_top[lowest].m_count = count;
+  }
+
+  /** @brief Counters are added, the frequent values of both sketches are estimated again in the merged sketch.
+   */
+  void QualExprCountMinSketch::merge(const QualExprCountMinSketch &replica)
+  {
+    for (size_t row = 0; row < DEPTH; row++) {
+      for (size_t column = 0; column < WIDTH; column++) m_cells[row][column] += replica.m_cells[row][column];
+    }
+    for (size_t index = 0; index < m_topSize; index++) m_top[index].m_count = estimate(m_top[index].m_value);
+    for (size_t index = 0; index < replica.m_topSize; index++) offer(replica.m_top[index].m_value, estimate(replica.m_top[index].m_value));
+  }
+
+  bool QualExprCountMinSketch::top(size_t rank, long long &value, size_t &count) const
+  {
+    if (rank < 1 || rank > m_topSize) return false;
+    heavy_t sorted[TOP];
+    size_t size = 0;
+    for (size_t index = 0; index < m_topSize; index++) {
+      size_t position = size++;
+      while (position && (sorted[position - 1].m_count < m_top[index].m_count ||
+                          (sorted[position - 1].m_count == m_top[index].m_count && sorted[position - 1].m_value > m_top[index].m_value))) {
+        sorted[position] = sorted[position - 1];
+        position--;
+      }
+      sorted[position] = m_top[index];
+    }
+    value = sorted[rank - 1].m_value;
+    count = sorted[rank - 1].m_count;
+    return true;
+  }
+
+  /** @brief Return the value of rank ceil(permille * count / 1000).
+      The middle of the bucket holding the rank is returned, bounded by the exact extrema. An empty histogram returns 0.
+  */
+  long long QualExprHistogram::quantile(unsigned int permille) const
+  {
+    if (!m_count) return 0;
+    size_t rank = (permille * m_count + 999) / 1000;
+    if (rank <= 1) return m_min;
+    if (rank >= m_count) return m_max;
+    size_t index = 0;
+    for (size_t seen = m_buckets[0]; seen < rank; seen += m_buckets[index]) index++;
+    long long width = index < LINEAR ? 1 : 1LL << (index / LINEAR - 1);
+    long long value = lowerBound(index) + (width - 1) / 2;
+    if (value < m_min) value = m_min;
+    if (value > m_max) value = m_max;
+    return value;
+  }
+
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+
   void QualExprAggregatorTime::registerToAggregatorNS(QualExprAggregatorNamespace &aggregNs)
   {
     new QualExprAggregatorTimeSum(aggregNs);
     new QualExprAggregatorTimeAverage(aggregNs);
     new QualExprAggregatorTimeMax(aggregNs);
     new QualExprAggregatorTimeMin(aggregNs);
+    new QualExprAggregatorQuantile<QualExprAggregatorTime>(aggregNs, 500, "|p50");
+    new QualExprAggregatorQuantile<QualExprAggregatorTime>(aggregNs, 900, "|p90");
+    new QualExprAggregatorQuantile<QualExprAggregatorTime>(aggregNs, 990, "|p99");
+    new QualExprAggregatorQuantile<QualExprAggregatorTime>(aggregNs, 999, "|p999");
+    new QualExprAggregatorVariance<QualExprAggregatorTime>(aggregNs, false, "|var");
+    new QualExprAggregatorVariance<QualExprAggregatorTime>(aggregNs, true, "|stddev");
+    new QualExprAggregatorWindow<QualExprAggregatorTime>(aggregNs, 1000000000LL, false, "|time-1s");
+    new QualExprAggregatorWindow<QualExprAggregatorTime>(aggregNs, 1000000000LL, true, "|time-count-1s");
+    new QualExprAggregatorDecayed<QualExprAggregatorTime>(aggregNs, 1000000000LL, "~time-1s");
+    new QualExprAggregatorWindow<QualExprAggregatorTime>(aggregNs, 10000000000LL, false, "|time-10s");
+    new QualExprAggregatorWindow<QualExprAggregatorTime>(aggregNs, 10000000000LL, true, "|time-count-10s");
+    new QualExprAggregatorDecayed<QualExprAggregatorTime>(aggregNs, 10000000000LL, "~time-10s");
+    new QualExprAggregatorWindow<QualExprAggregatorTime>(aggregNs, 60000000000LL, false, "|time-60s");
+    new QualExprAggregatorWindow<QualExprAggregatorTime>(aggregNs, 60000000000LL, true, "|time-count-60s");
+    new QualExprAggregatorDecayed<QualExprAggregatorTime>(aggregNs, 60000000000LL, "~time-60s");
   }
 
-  void QualExprAggregatorTimeAverage::processEvent(const QualExprEvent &event)
+  /** @brief Record start events and match stop events with their start event.
+      @return true on a matched stop event.
+  */
+  QualExprAggregator * QualExprAggregatorTime::replicate(void) const
+  {
+    QualExprAggregatorTime *replica = static_cast<QualExprAggregatorTime *>(build(getId()));
+    replica->m_openIntervals.share(m_openIntervals);
+    return replica;
+  }
+
+  bool QualExprAggregatorTime::duration(const QualExprEvent &event, long64_t &duration)
   {
     if (event.m_state == D_START) {
-      m_previousTimeStamp = (event.m_timestamp * 1e9);
-      m_previousEid = event.m_eid;
+      m_openIntervals.open(event.m_eid, event.m_timestamp, 0);
     }
     else if (event.m_state == D_STOP) {
-      if (m_previousEid == event.m_eid) {
-        m_count ++;
-        m_value += (event.m_timestamp * 1e9) - m_previousTimeStamp;
+      qualexpr_time_t start;
+      long long value;
+      if (m_openIntervals.close(event.m_eid, start, value)) {
+        duration = event.m_timestamp - start;
+        return true;
       }
     }
+    return false;
+  }
+
+  void QualExprAggregatorTimeAverage::processEvent(const QualExprEvent &event)
+  {
+    long64_t newValue;
+    if (duration(event, newValue)) {
+      count() ++;
+      value() += newValue;
+    }
   }
 
   void QualExprAggregatorTimeAverage::display(const std::string &indent, std::stringstream &s) const
   {
-    s << " time average["<<m_count<<"]=" << std::setprecision(24) << evaluate();
+    s << " time average["<<count()<<"]=" << std::setprecision(24) << evaluate();
   }
 
   void QualExprAggregatorTimeMax::processEvent(const QualExprEvent &event)
   {
-    if (event.m_state == D_START) {
-      m_previousTimeStamp = (event.m_timestamp * 1e9);
-      m_previousEid = event.m_eid;
-    }
-    else if (event.m_state == D_STOP) {
-      if (m_previousEid == event.m_eid) {
-        m_count ++;
-        long64_t newValue = (event.m_timestamp * 1e9) - m_previousTimeStamp;
-        if (m_value < newValue) m_value = newValue;
-      }
+    long64_t newValue;
+    if (duration(event, newValue)) {
+      count() ++;
+      if (value() < newValue) value() = newValue;
     }
   }
 
   void QualExprAggregatorTimeMax::display(const std::string &indent, std::stringstream &s) const
   {
-    s << " time max["<<m_count<<"]=" << std::setprecision(24) << evaluate();
+    s << " time max["<<count()<<"]=" << std::setprecision(24) << evaluate();
   }
 
   void QualExprAggregatorTimeMin::processEvent(const QualExprEvent &event)
   {
-    if (event.m_state == D_START) {
-      m_previousTimeStamp = (event.m_timestamp * 1e9);
-      m_previousEid = event.m_eid;
-    }
-    else if (event.m_state == D_STOP) {
-      if (m_previousEid == event.m_eid) {
-        m_count ++;
-        long64_t newValue = (event.m_timestamp * 1e9) - m_previousTimeStamp;
-        if (m_value < 0 || m_value > newValue) m_value = newValue;
-      }
+    long64_t newValue;
+    if (duration(event, newValue)) {
+      count() ++;
+      if (value() < 0 || value() > newValue) value() = newValue;
     }
   }
 
   void QualExprAggregatorTimeMin::display(const std::string &indent, std::stringstream &s) const
   {
-    s << " time min["<<m_count<<"]=" << std::setprecision(24) << evaluate();
+    s << " time min["<<count()<<"]=" << std::setprecision(24) << evaluate();
   }
 
   void QualExprAggregatorTimeSum::processEvent(const QualExprEvent &event)
   {
-    if (event.m_state == D_START) {
-      m_previousTimeStamp = (event.m_timestamp * 1e9);
-      m_previousEid = event.m_eid;
-    }
-    else if (event.m_state == D_STOP) {
-      if (m_previousEid == event.m_eid) {
-        m_count ++;
-        long64_t newValue = (event.m_timestamp * 1e9) - m_previousTimeStamp;
-        m_value += newValue;
-      }
+    long64_t newValue;
+    if (duration(event, newValue)) {
+      count() ++;
+      value() += newValue;
     }
   }
 
   void QualExprAggregatorTimeSum::display(const std::string &indent, std::stringstream &s) const
   {
-    s << " time accumulated["<<m_count<<"]=" << std::setprecision(24) << evaluate();
+    s << " time accumulated["<<count()<<"]=" << std::setprecision(24) << evaluate();
   }
 
   /* ---------------------------------------------------------------------------------------------------------------- */
@@ -185,52 +613,67 @@ namespace quality_expressions_core
     new QualExprAggregatorSizeAverage(aggregNs);
     new QualExprAggregatorSizeMax(aggregNs);
     new QualExprAggregatorSizeMin(aggregNs);
+    new QualExprAggregatorQuantile<QualExprAggregatorSize>(aggregNs, 500, "|size-p50");
+    new QualExprAggregatorQuantile<QualExprAggregatorSize>(aggregNs, 900, "|size-p90");
+    new QualExprAggregatorQuantile<QualExprAggregatorSize>(aggregNs, 990, "|size-p99");
+    new QualExprAggregatorQuantile<QualExprAggregatorSize>(aggregNs, 999, "|size-p999");
+    new QualExprAggregatorVariance<QualExprAggregatorSize>(aggregNs, false, "|size-var");
+    new QualExprAggregatorVariance<QualExprAggregatorSize>(aggregNs, true, "|size-stddev");
+    new QualExprAggregatorWindow<QualExprAggregatorSize>(aggregNs, 1000000000LL, false, "|size-1s");
+    new QualExprAggregatorWindow<QualExprAggregatorSize>(aggregNs, 1000000000LL, true, "|size-count-1s");
+    new QualExprAggregatorDecayed<QualExprAggregatorSize>(aggregNs, 1000000000LL, "~size-1s");
+    new QualExprAggregatorWindow<QualExprAggregatorSize>(aggregNs, 10000000000LL, false, "|size-10s");
+    new QualExprAggregatorWindow<QualExprAggregatorSize>(aggregNs, 10000000000LL, true, "|size-count-10s");
+    new QualExprAggregatorDecayed<QualExprAggregatorSize>(aggregNs, 10000000000LL, "~size-10s");
+    new QualExprAggregatorWindow<QualExprAggregatorSize>(aggregNs, 60000000000LL, false, "|size-60s");
+    new QualExprAggregatorWindow<QualExprAggregatorSize>(aggregNs, 60000000000LL, true, "|size-count-60s");
+    new QualExprAggregatorDecayed<QualExprAggregatorSize>(aggregNs, 60000000000LL, "~size-60s");
   }
 
   void QualExprAggregatorSizeSum::processEvent(const QualExprEvent &event)
   {
     if (event.m_state == D_START || event.m_state == D_COUNTER) {
-      m_count ++;
-      m_value += event.m_value;
+      count() ++;
+      value() += event.m_value;
     }
   }
 
   void QualExprAggregatorSizeSum::display(const std::string &indent, std::stringstream &s) const
   {
-    s << " size accumulated=" << std::setprecision(24) << evaluate() << " in " << m_count << " calls"  ;
+    s << " size accumulated=" << std::setprecision(24) << evaluate() << " in " << count() << " calls"  ;
   }
 
   void QualExprAggregatorSizeAverage::display(const std::string &indent, std::stringstream &s) const
   {
-    s << " size average=" << std::setprecision(24) << evaluate() << " in " << m_count << " calls"  ;
+    s << " size average=" << std::setprecision(24) << evaluate() << " in " << count() << " calls"  ;
   }
 
   void QualExprAggregatorSizeMax::processEvent(const QualExprEvent &event)
   {
     if (event.m_state == D_START) {
-      m_count ++;
+      count() ++;
       long64_t newValue = event.m_value;
-      if (m_value < newValue) m_value = newValue;
+      if (value() < newValue) value() = newValue;
     }
   }
 
   void QualExprAggregatorSizeMax::display(const std::string &indent, std::stringstream &s) const
   {
-    s << " size max=" << std::setprecision(24) << evaluate() << " in " << m_count << " calls"  ;
+    s << " size max=" << std::setprecision(24) << evaluate() << " in " << count() << " calls"  ;
   }
 
   void QualExprAggregatorSizeMin::processEvent(const QualExprEvent &event)
   {
     if (event.m_state == D_START) {
-      m_count ++;
+      count() ++;
       long64_t newValue = event.m_value;
-      if (m_value < 0 || m_value > newValue) m_value = newValue;
+      if (value() < 0 || value() > newValue) value() = newValue;
     }
   }
 
   void QualExprAggregatorSizeMin::display(const std::string &indent, std::stringstream &s) const
   {
-    s << " size min=" << std::setprecision(24) << evaluate() << " in " << m_count << " calls"  ;
+    s << " size min=" << std::setprecision(24) << evaluate() << " in " << count() << " calls"  ;
   }
 
   /* ---------------------------------------------------------------------------------------------------------------- */
@@ -243,71 +686,77 @@ namespace quality_expressions_core
     new QualExprAggregatorBandwidthAverage(aggregNs);
     new QualExprAggregatorBandwidthMax(aggregNs);
     new QualExprAggregatorBandwidthMin(aggregNs);
+    new QualExprAggregatorVariance<QualExprAggregatorBandwidth>(aggregNs, false, "|bw-var");
+    new QualExprAggregatorVariance<QualExprAggregatorBandwidth>(aggregNs, true, "|bw-stddev");
   }
 
-  void QualExprAggregatorBandwidthAverage::processEvent(const QualExprEvent &event)
+  QualExprAggregator * QualExprAggregatorBandwidth::replicate(void) const
+  {
+    QualExprAggregatorBandwidth *replica = static_cast<QualExprAggregatorBandwidth *>(build(getId()));
+    replica->m_openIntervals.share(m_openIntervals);
+    return replica;
+  }
+
+  /** @brief Record start events with their size and match stop events with their start event.
+      @return true on a matched stop event.
+  */
+  bool QualExprAggregatorBandwidth::bandwidth(const QualExprEvent &event, long64_t &bandwidth)
   {
     if (event.m_state == D_START) {
-      m_previousTimeStamp = event.m_timestamp;
-      m_previousEid = event.m_eid;
-      m_currentSize = event.m_value;
+      m_openIntervals.open(event.m_eid, event.m_timestamp, event.m_value);
     }
     else if (event.m_state == D_STOP) {
-      if (m_previousEid == event.m_eid) {
-        m_count ++;
-        double time = event.m_timestamp - m_previousTimeStamp;
-        m_value = (m_currentSize / time);
+      qualexpr_time_t start;
+      long long size;
+      if (m_openIntervals.close(event.m_eid, start, size) && event.m_timestamp > start) {
+        double time = (event.m_timestamp - start) / 1e9;
+        bandwidth = size / time;
+        return true;
       }
     }
+    return false;
+  }
+
+  void QualExprAggregatorBandwidthAverage::processEvent(const QualExprEvent &event)
+  {
+    long64_t newValue;
+    if (bandwidth(event, newValue)) {
+      count() ++;
+      value() += newValue;
+    }
   }
 
   void QualExprAggregatorBandwidthAverage::display(const std::string &indent, std::stringstream &s) const
   {
-    s << indent << " bandwidth average=" << std::setprecision(24) << evaluate() << " in " << m_count << " calls"  ;
+    s << indent << " bandwidth average=" << std::setprecision(24) << evaluate() << " in " << count() << " calls"  ;
   }
 
   void QualExprAggregatorBandwidthMax::processEvent(const QualExprEvent &event)
   {
-    if (event.m_state == D_START) {
-      m_previousTimeStamp = event.m_timestamp;
-      m_previousEid = event.m_eid;
-      m_currentSize = event.m_value;
-    }
-    else if (event.m_state == D_STOP) {
-      if (m_previousEid == event.m_eid) {
-        m_count ++;
-        double time = event.m_timestamp - m_previousTimeStamp;
-        long64_t newValue = m_currentSize / time;
-        if (m_value < newValue) m_value = newValue;
-      }
+    long64_t newValue;
+    if (bandwidth(event, newValue)) {
+      count() ++;
+      if (value() < newValue) value() = newValue;
     }
   }
 
   void QualExprAggregatorBandwidthMax::display(const std::string &indent, std::stringstream &s) const
   {
-    s << indent << " bandwidth max=" << std::setprecision(24) << evaluate() << " in " << m_count << " calls"  ;
+    s << indent << " bandwidth max=" << std::setprecision(24) << evaluate() << " in " << count() << " calls"  ;
   }
 
   void QualExprAggregatorBandwidthMin::processEvent(const QualExprEvent &event)
   {
-    if (event.m_state == D_START) {
-      m_previousTimeStamp = event.m_timestamp;
-      m_previousEid = event.m_eid;
-      m_currentSize = event.m_value;
-    }
-    else if (event.m_state == D_STOP) {
-      if (m_previousEid == event.m_eid) {
-        m_count ++;
-        double time = event.m_timestamp - m_previousTimeStamp;
-        long64_t newValue = m_currentSize / time;
-        if (m_value < 0 || m_value > newValue) m_value = newValue;
-      }
+    long64_t newValue;
+    if (bandwidth(event, newValue)) {
+      count() ++;
+      if (value() < 0 || value() > newValue) value() = newValue;
     }
   }
 
   void QualExprAggregatorBandwidthMin::display(const std::string &indent, std::stringstream &s) const
   {
-    s << indent << " bandwidth min=" << std::setprecision(24) << evaluate() << " in " << m_count << " calls"  ;
+    s << indent << " bandwidth min=" << std::setprecision(24) << evaluate() << " in " << count() << " calls"  ;
   }
 
   /* ---------------------------------------------------------------------------------------------------------------- */
@@ -315,31 +764,388 @@ namespace quality_expressions_core
   /* ---------------------------------------------------------------------------------------------------------------- */
   /* ---------------------------------------------------------------------------------------------------------------- */
 
+  void QualExprAggregatorFrequency::registerToAggregatorNS(QualExprAggregatorNamespace &aggregNs)
+  {
+    new QualExprAggregatorFrequencySketch(aggregNs, QualExprAggregatorFrequencySketch::Q_FREQUENCY, "|freq-");
+    new QualExprAggregatorFrequencySketch(aggregNs, QualExprAggregatorFrequencySketch::Q_TOP_VALUE, "|top-");
+    new QualExprAggregatorFrequencySketch(aggregNs, QualExprAggregatorFrequencySketch::Q_TOP_COUNT, "|top-count-");
+  }
+
+  void QualExprAggregatorFrequencySketch::processEvent(const QualExprEvent &event)
+  {
+    if (event.m_state == D_START || event.m_state == D_COUNTER) m_sketch.record(event.m_value);
+  }
+
+  long64_t QualExprAggregatorFrequencySketch::evaluate(void) const
+  {
+    if (m_query == Q_FREQUENCY) return m_sketch.estimate(m_parameter);
+    long long value = 0;
+    size_t count = 0;
+    if (!m_sketch.top(m_parameter, value, count)) return 0;
+    return m_query == Q_TOP_VALUE ? value : (long64_t) count;
+  }
+
+  /** @brief Build the aggregator named by the prefix followed by an integer, ranks must be in [1, TOP].
+   */
+  QualExprAggregator * QualExprAggregatorFrequencySketch::buildFromName(const std::string &name, size_t id) const
+  {
+    if (name.compare(0, m_name.size(), m_name) || name.size() == m_name.size()) return NULL;
+    const char *parameter = name.c_str() + m_name.size();
+    char *end = NULL;
+    long long value = strtoll(parameter, &end, 10);
+    if (*end || !isdigit(parameter[*parameter == '-' ? 1 : 0])) return NULL;
+    if (m_query != Q_FREQUENCY && (value < 1 || value > QualExprCountMinSketch::TOP)) return NULL;
+    return new QualExprAggregatorFrequencySketch(id, m_query, value, name);
+  }
+
+  void QualExprAggregatorFrequencySketch::display(const std::string &indent, std::stringstream &s) const
+  {
+    static const char * const queries[] = { " frequency of ", " top value ", " top count " };
+    s << indent << " value" << queries[m_query] << m_parameter << "=" << std::setprecision(24) << evaluate();
+  }
+
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+
+  /* Destructor */ QualExprSemanticAggregator::~QualExprSemanticAggregator(void)
+  {
+    while (m_replicaList) {
+      replica_t *replica = m_replicaList;
+      m_replicaList = replica->m_next;
+      delete replica->m_aggregator;
+      delete replica;
+    }
+    delete m_retired;
+    delete m_scratch;
+    delete &m_sem;
+    delete &m_aggregator;
+  }
+
+  void QualExprSemanticAggregator::reset(void)
+  {
+    m_scratchLock.lock();
+    m_resets++;
+    m_aggregator.reset();
+    if (m_retired) m_retired->reset();
+    for(replica_t *replica = m_replicaList; replica; replica = replica->m_next) {
+      replica->m_aggregator->reset();
+    }
+    m_scratchLock.unlock();
+  }
+
+  /** @brief Return the update counter.
+      Versions only increase: events increase the replica versions and resets the reset counter. A retired
+      replica keeps its version in the retired counter.
+  */
+  unsigned long QualExprSemanticAggregator::currentVersion(void) const
+  {
+    unsigned long version = m_resets + m_retiredVersion;
+    for(const replica_t *replica = m_replicaList; replica; replica = replica->m_next) {
+      version += replica->m_aggregator->version();
+    }
+    return version;
+  }
+
+  /** @brief Return the replica of the calling thread, missing from the thread cache.
+      Only the owner thread pushes its replica, so a replica is never built twice for a thread.
+  */
+  QualExprAggregator & QualExprSemanticAggregator::buildReplica(void)
+  {
+    pthread_t self = pthread_self();
+    m_scratchLock.lock();
+    replica_t *replica = m_replicaList;
+    while (replica && !pthread_equal(replica->m_owner, self)) replica = replica->m_next;
+    if (!replica) {
+      replica = new replica_t;
+      replica->m_owner = self;
+      replica->m_aggregator = m_aggregator.replicate();
+      replica->m_next = m_replicaList;
+      m_replicaList = replica;
+    }
+    m_scratchLock.unlock();
+    ReplicaCache_t::store(m_replicaKey, 0, replica->m_aggregator);
+    return *replica->m_aggregator;
+  }
+
+  /** @brief Merge the replica of a terminated thread in the retired aggregator and free it.
+      The version is unchanged, so a merge of the replicas done before stays valid.
+  */
+  void QualExprSemanticAggregator::retireReplica(pthread_t owner)
+  {
+    m_scratchLock.lock();
+    replica_t **link = &m_replicaList;
+    while (*link && !pthread_equal((*link)->m_owner, owner)) link = &(*link)->m_next;
+    replica_t *replica = *link;
+    if (replica) {
+      *link = replica->m_next;
+      if (!m_retired) m_retired = m_aggregator.build(m_aggregator.getId());
+      m_retired->merge(*replica->m_aggregator);
+      m_retiredVersion += replica->m_aggregator->version();
+      delete replica->m_aggregator;
+      delete replica;
+    }
+    m_scratchLock.unlock();
+  }
+
+  /** @brief Merge all thread replicas with the retired ones.
+      A single replica is returned as is, otherwise the replicas are merged in the scratch aggregator,
+      unless they are unchanged since the last merge. Called with the scratch lock held.
+  */
+  const QualExprAggregator & QualExprSemanticAggregator::mergedAggregator(void) const
+  {
+    const replica_t *replica = m_replicaList;
+    if (!replica) return m_retired ? *m_retired : m_aggregator;
+    if (!replica->m_next && !m_retired) return *replica->m_aggregator;
+
+    unsigned long version = currentVersion();
+    if (m_scratch && m_scratchVersion == version) return *m_scratch;
+    if (!m_scratch) m_scratch = m_aggregator.build(m_aggregator.getId());
+    m_scratchVersion = version;
+    m_scratch->reset();
+    if (m_retired) m_scratch->merge(*m_retired);
+    for(; replica; replica = replica->m_next) {
+      m_scratch->merge(*replica->m_aggregator);
+    }
+    return *m_scratch;
+  }
+
+  QualExprSemanticAggregatorDB *QualExprSemanticAggregatorDB::g_dbList = NULL;
+  static pthread_mutex_t g_dbListLock = PTHREAD_MUTEX_INITIALIZER;	//!< Protects the list of databases alive.
+  static pthread_key_t g_threadKey;					//!< Key set by threads owning a shard, its destructor retires them.
+  static pthread_once_t g_threadKeyOnce = PTHREAD_ONCE_INIT;
+
+  static void createThreadKey(void)
+  {
+    pthread_key_create(&g_threadKey, QualExprSemanticAggregatorDB::releaseThread);
+  }
+
+  void QualExprSemanticAggregatorDB::linkDB(void)
+  {
+    pthread_mutex_lock(&g_dbListLock);
+    m_nextDB = g_dbList;
+    g_dbList = this;
+    pthread_mutex_unlock(&g_dbListLock);
+  }
+
   /* Destructor */ QualExprSemanticAggregatorDB::~QualExprSemanticAggregatorDB(void)
   {
+    pthread_mutex_lock(&g_dbListLock);
+    QualExprSemanticAggregatorDB **link = &g_dbList;
+    while (*link != this) link = &(*link)->m_nextDB;
+    *link = m_nextDB;
+    pthread_mutex_unlock(&g_dbListLock);
     clearMeasures();
   }
 
+  /** @brief Thread termination: the thread shards are freed and its replicas are merged in the retired aggregators.
+      Called in the terminating thread, for all databases since a database may be deleted before the thread.
+  */
+  void QualExprSemanticAggregatorDB::releaseThread(void *marker)
+  {
+    pthread_t self = pthread_self();
+    pthread_mutex_lock(&g_dbListLock);
+    for(QualExprSemanticAggregatorDB *db = g_dbList; db; db = db->m_nextDB) {
+      db->retireThread(self);
+    }
+    pthread_mutex_unlock(&g_dbListLock);
+  }
+
+  void QualExprSemanticAggregatorDB::retireThread(pthread_t owner)
+  {
+    m_shardLock.lock();
+    shard_t **link = &m_shardList;
+    while (*link && !pthread_equal((*link)->m_owner, owner)) link = &(*link)->m_next;
+    shard_t *shard = *link;
+    if (shard) {
+      *link = shard->m_next;
+      releaseShard(shard);
+    }
+    for(size_t index = 0; index < m_semAggregatorList.size(); index++) {
+      m_semAggregatorList[index]->retireReplica(owner);
+    }
+    m_shardLock.unlock();
+  }
+
   void QualExprSemanticAggregatorDB::cacheAggregators(void)
   {
     if (!m_semAggregatorQuickList) {
       size_t size = m_semAggregatorList.size();
-      m_semAggregatorQuickList = (QualExprSemanticAggregator **) malloc((size+1) * sizeof(QualExprSemanticAggregator *));
+      QualExprSemanticAggregator **quickList = (QualExprSemanticAggregator **) malloc((size+1) * sizeof(QualExprSemanticAggregator *));
       for(size_t index = 0; index < size ; index++) {
-        m_semAggregatorQuickList[index] = m_semAggregatorList[index];
+        quickList[index] = m_semAggregatorList[index];
       }
-      m_semAggregatorQuickList[size] = NULL;
+      quickList[size] = NULL;
+      if (!atomic_cas<QualExprSemanticAggregator **>(m_semAggregatorQuickList, NULL, quickList)) free(quickList);
+    }
+    if (!m_dispatch) {
+      dispatch_t *dispatch = buildDispatch(m_semAggregatorQuickList);
+      if (!atomic_cas<dispatch_t *>(m_dispatch, NULL, dispatch)) delete dispatch;
     }
   }
 
+  /** @brief Build the semantic ID dispatch index.
+      Semantic IDs matched by aggregators are grouped in dense blocks: a new block is started when the gap
+      with the previous ID is larger than maxGap, so unrelated ID ranges do not produce huge tables.
+      Lanes are numbered in the order of the first semantic ID matched, sorted by source and accumulation, so
+      the lanes of a semantic ID are consecutive unless its aggregators also match a previous semantic ID.
+      The source of a group is sampled by the first aggregator of the source, the same for all groups of an ID.
+  */
+  QualExprSemanticAggregatorDB::dispatch_t * QualExprSemanticAggregatorDB::buildDispatch(QualExprSemanticAggregator **quickList) const
+  {
+    const unsigned int maxGap = 64;
+    std::map<unsigned int, std::vector<unsigned int> > semanticMap;
+    std::vector<int> laneOf;
+    dispatch_t *dispatch = new dispatch_t;
+
+    for(unsigned int index = 0; quickList[index]; index++) {
+      unsigned int first = 0, last = 0;
+      laneOf.push_back(-1);
+      if (quickList[index]->semanticRange(first, last)) {
+        for(unsigned int sem = first; sem < last; sem++) {
+          if (quickList[index]->matchSemantic(sem)) semanticMap[sem].push_back(index);
+        }
+      }
+      else dispatch->m_unranged.push_back(index);
+    }
+
+    dispatchBlock_t *block = NULL;
+    for(std::map<unsigned int, std::vector<unsigned int> >::const_iterator ite = semanticMap.begin(); ite != semanticMap.end(); ite++) {
+      unsigned int sem = ite->first;
+      if (!block || sem - (block->m_base + block->m_size) > maxGap) {
+        if (block) {
+          dispatch->m_offsets.push_back(dispatch->m_aggregators.size());
+          dispatch->m_groupOffsets.push_back(dispatch->m_groups.size());
+        }
+        dispatchBlock_t newBlock = { sem, 0, dispatch->m_offsets.size() };
+        dispatch->m_blocks.push_back(newBlock);
+        block = & dispatch->m_blocks.back();
+      }
+      for(; block->m_base + block->m_size < sem; block->m_size++) {
+        dispatch->m_offsets.push_back(dispatch->m_aggregators.size());
+        dispatch->m_groupOffsets.push_back(dispatch->m_groups.size());
+      }
+      dispatch->m_offsets.push_back(dispatch->m_aggregators.size());
+      dispatch->m_groupOffsets.push_back(dispatch->m_groups.size());
+
+      // -- Aggregators with a lane, sorted by source and accumulation.
+      std::vector<unsigned int> laned;
+      for(size_t index = 0; index < ite->second.size(); index++) {
+        unsigned int aggreg = ite->second[index];
+        const QualExprSemanticAggregator &replica = *quickList[aggreg];
+        if (replica.lane() == QualExprAggregator::LANE_NONE || !replica.laneSource()) {
+          dispatch->m_aggregators.push_back(aggreg);
+          continue;
+        }
+        size_t position = laned.size();
+        laned.push_back(aggreg);
+        for(; position; position--) {
+          const QualExprSemanticAggregator &previous = *quickList[laned[position - 1]];
+          int order = strcmp(previous.laneSource(), replica.laneSource());
+          if (order < 0 || (!order && previous.lane() <= replica.lane())) break;
+          laned[position] = laned[position - 1];
+        }
+        laned[position] = aggreg;
+      }
+
+      // -- Lanes numbered on their first semantic ID, and groups of consecutive lanes.
+      unsigned int source = 0;
+      for(size_t index = 0; index < laned.size(); index++) {
+        unsigned int aggreg = laned[index];
+        if (laneOf[aggreg] < 0) {
+          laneOf[aggreg] = dispatch->m_lanes.size();
+          dispatch->m_lanes.push_back(aggreg);
+        }
+        const QualExprSemanticAggregator &replica = *quickList[aggreg];
+        if (!index || strcmp(quickList[source]->laneSource(), replica.laneSource())) source = aggreg;
+        laneGroup_t *group = dispatch->m_groups.size() > dispatch->m_groupOffsets.back() ? & dispatch->m_groups.back() : NULL;
+        if (group && group->m_source == source && group->m_lane == replica.lane() && group->m_end == (unsigned int) laneOf[aggreg]) group->m_end++;
+        else {
+          laneGroup_t newGroup = { source, replica.lane(), (unsigned int) laneOf[aggreg], (unsigned int) laneOf[aggreg] + 1 };
+          dispatch->m_groups.push_back(newGroup);
+        }
+      }
+      block->m_size++;
+    }
+    if (block) {
+      dispatch->m_offsets.push_back(dispatch->m_aggregators.size());
+      dispatch->m_groupOffsets.push_back(dispatch->m_groups.size());
+    }
+    return dispatch;
+  }
+
   void QualExprSemanticAggregatorDB::cleanAggregatorCache(void)
   {
+    m_shardLock.lock();
+    while (m_shardList) {
+      shard_t *shard = m_shardList;
+      m_shardList = shard->m_next;
+      releaseShard(shard);
+    }
+    m_shardLock.unlock();
+    m_shardKey = QualExprThreadCache<QualExprSemanticAggregatorDB>::newOwnerKey();
+    delete m_dispatch;
+    m_dispatch = NULL;
     if (m_semAggregatorQuickList) {
       free(m_semAggregatorQuickList);
       m_semAggregatorQuickList = NULL;
     }
   }
 
+  /** @brief Return the shard of the calling thread.
+      The shard is built on the first event of the thread, then found in the thread local cache.
+  */
+  QualExprSemanticAggregatorDB::shard_t * QualExprSemanticAggregatorDB::threadShard(void)
+  {
+    typedef QualExprThreadCache<QualExprSemanticAggregatorDB> ShardCache_t;
+    shard_t *cached = (shard_t *) ShardCache_t::find(m_shardKey, 0);
+    if (cached) return cached;
+
+    cacheAggregators();
+    pthread_t self = pthread_self();
+    m_shardLock.lock();
+    shard_t *shard = m_shardList;
+    while (shard && !pthread_equal(shard->m_owner, self)) shard = shard->m_next;
+
+    if (!shard) {
+      size_t size = m_semAggregatorList.size();
+      shard = new shard_t;
+      shard->m_owner = self;
+      shard->m_replicas = (QualExprAggregator **) malloc((size+1) * sizeof(QualExprAggregator *));
+      for(size_t index = 0; index < size ; index++) {
+        shard->m_replicas[index] = & m_semAggregatorQuickList[index]->threadReplica();
+      }
+      shard->m_replicas[size] = NULL;
+      const std::vector<unsigned int> &lanes = m_dispatch->m_lanes;
+      shard->m_lanes = new QualExprLanes(lanes.size());
+      for(size_t lane = 0; lane < lanes.size(); lane++) {
+        m_semAggregatorQuickList[lanes[lane]]->bindReplica(*shard->m_replicas[lanes[lane]], shard->m_lanes, lane);
+      }
+      shard->m_next = m_shardList;
+      m_shardList = shard;
+    }
+    m_shardLock.unlock();
+    pthread_once(&g_threadKeyOnce, createThreadKey);
+    if (!pthread_getspecific(g_threadKey)) pthread_setspecific(g_threadKey, this);
+    ShardCache_t::store(m_shardKey, 0, shard);
+    return shard;
+  }
+
+  /** @brief Free a shard, the state of its replicas is moved back from the lanes.
+      Called with the shard lock held, while the dispatch index the shard was built with is alive.
+  */
+  void QualExprSemanticAggregatorDB::releaseShard(shard_t *shard)
+  {
+    const std::vector<unsigned int> &lanes = m_dispatch->m_lanes;
+    for(size_t lane = 0; lane < lanes.size(); lane++) {
+      m_semAggregatorQuickList[lanes[lane]]->bindReplica(*shard->m_replicas[lanes[lane]], NULL, 0);
+    }
+    delete shard->m_lanes;
+    free(shard->m_replicas);
+    delete shard;
+  }
+
   void QualExprSemanticAggregatorDB::resetMeasures(void)
   {
     for(size_t index = 0; index < m_semAggregatorList.size(); index++) {
@@ -350,10 +1156,12 @@ namespace quality_expressions_core
   void QualExprSemanticAggregatorDB::clearMeasures(void)
   {
     cleanAggregatorCache();
+    m_shardLock.lock();
     for(size_t index = 0; index < m_semAggregatorList.size(); index++) {
       delete m_semAggregatorList[index];
     }
     m_semAggregatorList.clear();
+    m_shardLock.unlock();
   }
 
   QualExprSemanticAggregator & QualExprSemanticAggregatorDB::pushAggregator(const QualityExpression &measure) throw(QualExprSemanticAggregatorDB::Exception)
@@ -384,7 +1192,7 @@ namespace quality_expressions_core
 
         for(size_t index = 0; index < m_semAggregatorList.size(); index++) {
           QualExprSemanticAggregator * semAggreg = m_semAggregatorList[index];
-          if (semAggreg->aggregName() == aggreg->name() && semAggreg->semanticName() == semDesc->name()) {
+          if (!strcmp(semAggreg->aggregName(), aggreg->name()) && !strcmp(semAggreg->semanticName(), semDesc->name())) {
             newAggreg = semAggreg;
             break;
           }
@@ -393,8 +1201,11 @@ namespace quality_expressions_core
         if (!newAggreg) {
           newAggreg = new QualExprSemanticAggregator(*semDesc, *aggreg);
           cleanAggregatorCache();
+          m_shardLock.lock();
           m_semAggregatorList.push_back(newAggreg);
+          m_shardLock.unlock();
         }
+        else { delete semDesc; delete aggreg; }
       }
       else { error = true; delete aggreg; }
     }
@@ -411,14 +1222,51 @@ namespace quality_expressions_core
     cacheAggregators();
   }
 
-  void QualExprSemanticAggregatorDB::evaluateEvent(const QualExprEvent &event) throw()
+  /** @brief Update the replicas of the calling thread with a batch of events.
+      Events are processed in runs of the same semantic ID, of at most LANE_RUN events. Each aggregator
+      still receives the events of a run in order: aggregators without lane one by one, lanes through the
+      samples of their source.
+  */
+  void QualExprSemanticAggregatorDB::evaluateEvents(const QualExprEvent *events, size_t count) throw()
   {
-    cacheAggregators();
-    unsigned int sem = event.m_semanticId;
-    for(size_t index = 0; m_semAggregatorQuickList[index]; index++) {
-      QualExprSemanticAggregator * semAggreg = m_semAggregatorQuickList[index];
-      if (semAggreg->matchSemantic(sem)) {
-        semAggreg->processEvent(event);
+    shard_t *shard = threadShard();
+    QualExprAggregator **replicas = shard->m_replicas;
+    const dispatch_t &dispatch = *m_dispatch;
+    long long samples[LANE_RUN];
+
+    for(size_t first = 0, last = 0; first < count; first = last) {
+      unsigned int sem = events[first].m_semanticId;
+      for(last = first + 1; last < count && last - first < LANE_RUN && events[last].m_semanticId == sem; last++);
+
+      for(size_t index = 0; index < dispatch.m_blocks.size(); index++) {
+        const dispatchBlock_t &block = dispatch.m_blocks[index];
+        if (sem - block.m_base < block.m_size) {
+          const size_t *span = & dispatch.m_offsets[block.m_offset + (sem - block.m_base)];
+          for(size_t aggreg = span[0]; aggreg < span[1]; aggreg++) {
+            QualExprAggregator *replica = replicas[dispatch.m_aggregators[aggreg]];
+            for(size_t event = first; event < last; event++) replica->aggregate(events[event]);
+          }
+          const size_t *groups = & dispatch.m_groupOffsets[block.m_offset + (sem - block.m_base)];
+          size_t sampled = 0;
+          for(size_t group = groups[0]; group < groups[1]; group++) {
+            const laneGroup_t &lanes = dispatch.m_groups[group];
+            if (group == groups[0] || lanes.m_source != dispatch.m_groups[group - 1].m_source) {
+              QualExprAggregator *source = replicas[lanes.m_source];
+              sampled = 0;
+              for(size_t event = first; event < last; event++) {
+                if (source->laneSample(events[event], samples[sampled])) sampled++;
+              }
+            }
+            shard->m_lanes->accumulate(lanes.m_lane, lanes.m_begin, lanes.m_end, samples, sampled, last - first);
+          }
+          break;
+        }
+      }
+      for(size_t index = 0; index < dispatch.m_unranged.size(); index++) {
+        unsigned int aggreg = dispatch.m_unranged[index];
+        if (m_semAggregatorQuickList[aggreg]->matchSemantic(sem)) {
+          for(size_t event = first; event < last; event++) replicas[aggreg]->aggregate(events[event]);
+        }
       }
     }
   }
@@ -442,12 +1290,13 @@ namespace quality_expressions_core
   */
   /* Constructor */ QualExprEvaluatorFrame::QualExprEvaluatorFrame(void) :
     m_semanticRootNamespace(""), m_aggregatorRootNamespace(""),
-    m_parser(*new QualExprEvaluatorParsingDriver())
+    m_parser(*new QualExprEvaluatorParsingDriver()), m_planCache()
   {
     QualExprAggregatorImmediate::registerToAggregatorNS(m_aggregatorRootNamespace);
     QualExprAggregatorTime::registerToAggregatorNS(m_aggregatorRootNamespace);
     QualExprAggregatorSize::registerToAggregatorNS(m_aggregatorRootNamespace);
     QualExprAggregatorBandwidth::registerToAggregatorNS(m_aggregatorRootNamespace);
+    QualExprAggregatorFrequency::registerToAggregatorNS(m_aggregatorRootNamespace);
   }
 
 
@@ -455,6 +1304,9 @@ namespace quality_expressions_core
   {
     lock();
     delete &m_parser;
+    for (PlanCache_t::iterator ite = m_planCache.begin(); ite != m_planCache.end(); ite++) {
+      delete ite->second;
+    }
     unlock();
   }
 
@@ -465,86 +1317,255 @@ namespace quality_expressions_core
 
   /** @brief Parse a quality expresion and register the corresponding aggregators.
       The quality expression is parsed to extract the list of entries and register
-      it with the entry ID.
+      it with the entry ID. The plan of a parsed expression is kept by mangled expression,
+      the next contexts registering the same expression instantiate the plan without parsing.
       Throw an exception for a parsing error.
       @return the number of entries parsed and registered.
   */
   QualExprComputeNode * QualExprEvaluatorFrame::buildExpressionEvaluationTree(QualExprEvaluator &context, const QualityExpression &expression) throw(QualExprEvaluatorFrame::Exception)
   {
-    QualExprComputeNode *newAggregNode;
+    QualExprComputeNode *newAggregNode = NULL;
 
-    try {
-      lock();
-      m_parser.parse(context, expression, expression);
-      newAggregNode = m_parser.result();
-      unlock();
-    } catch(QualExprEvaluatorParsingDriver::Exception e) {
-      std::stringstream s;
-      s << "syntax error: " << e.what();
-      throw(Exception(s.str()));
+    lock();
+    PlanCache_t::iterator ite = m_planCache.find(expression.mangle());
+    if (ite != m_planCache.end()) {
+      try {
+        newAggregNode = ite->second->instantiate(context);
+      }
+      catch(QualExprEvaluator::Exception e) {
+        delete ite->second;
+        m_planCache.erase(ite);
+      }
     }
 
+    if (!newAggregNode) {
+      try {
+        m_parser.parse(context, expression, expression);
+        newAggregNode = m_parser.result();
+      } catch(QualExprEvaluatorParsingDriver::Exception e) {
+        unlock();
+        std::stringstream s;
+        s << "syntax error: " << e.what();
+        throw(Exception(s.str()));
+      }
+      QualExprComputeProgram<long64_t> *program = dynamic_cast<QualExprComputeProgram<long64_t> *>(newAggregNode);
+      if (program) m_planCache[expression.mangle()] = new QualExprComputePlan(*program);
+    }
+    unlock();
+
     return newAggregNode;
   }
 
+  /* ---------------------------------------------------------------------------------------------------------------- */
+
+  /** @brief Build a plan from a program, aggregators are replaced by their names.
+   */
+  /* Constructor */ QualExprComputePlan::QualExprComputePlan(const QualExprComputeProgram<long64_t> &program) :
+    m_code(), m_aggregators()
+  {
+    for (size_t index = 0; index < program.size(); index++) {
+      QualExprComputeInstruction<long64_t> i = program.instruction(index);
+      AggregatorName_t name;
+      if (i.m_op == OP_AGGREGATOR) {
+        name.first = i.m_aggregator->semanticName();
+        name.second = i.m_aggregator->aggregName();
+        i.m_aggregator = NULL;
+      }
+      m_code.push_back(i);
+      m_aggregators.push_back(name);
+    }
+  }
+
+  /** @brief Build the program of a context, aggregators are registered in the context.
+      Throw an exception if an aggregator cannot be registered.
+  */
+  QualExprComputeProgram<long64_t> * QualExprComputePlan::instantiate(QualExprEvaluator &context) const
+  {
+    QualExprComputeProgram<long64_t> *program = new QualExprComputeProgram<long64_t>();
+    try {
+      for (size_t index = 0; index < m_code.size(); index++) {
+        QualExprComputeInstruction<long64_t> i = m_code[index];
+        if (i.m_op == OP_AGGREGATOR) i.m_aggregator = &context.pushSemanticAggregator(m_aggregators[index].first, m_aggregators[index].second);
+        program->push(i);
+      }
+    }
+    catch(QualExprEvaluator::Exception e) {
+      delete program;
+      throw;
+    }
+    return program;
+  }
+
   /* ---------------------------------------------------------------------------------------------------------------- */
   /* ---------------------------------------------------------------------------------------------------------------- */
   /* ---------------------------------------------------------------------------------------------------------------- */
   /* ---------------------------------------------------------------------------------------------------------------- */
 
+  /* Constructor */ QualExprEvaluatorStack::QualExprEvaluatorStack(void) :
+    m_contextDB(NULL), m_contextBuckets(16), m_evaluatorList(), m_globalList(), m_cacheKey(EvaluatorCache_t::newOwnerKey())
+  {
+    m_contextDB = (ContextEntry_t **) calloc(m_contextBuckets, sizeof(ContextEntry_t *));
+  }
+
+  /* Destructor */ QualExprEvaluatorStack::~QualExprEvaluatorStack(void)
+  {
+    clearEvaluators();
+    free(m_contextDB);
+  }
+
+  QualExprEvaluator * QualExprEvaluatorStack::findEvaluator(Context_t context) const
+  {
+    for(ContextEntry_t *entry = m_contextDB[bucket(context)]; entry; entry = entry->m_next) {
+      if (entry->m_context == context) return entry->m_evaluator;
+    }
+    return NULL;
+  }
+
+  void QualExprEvaluatorStack::growDirectory(void)
+  {
+    ContextEntry_t **oldDB = m_contextDB;
+    size_t oldBuckets = m_contextBuckets;
+    m_contextBuckets *= 2;
+    m_contextDB = (ContextEntry_t **) calloc(m_contextBuckets, sizeof(ContextEntry_t *));
+    for(size_t index = 0; index < oldBuckets; index++) {
+      while (oldDB[index]) {
+        ContextEntry_t *entry = oldDB[index];
+        oldDB[index] = entry->m_next;
+        size_t slot = bucket(entry->m_context);
+        entry->m_next = m_contextDB[slot];
+        m_contextDB[slot] = entry;
+      }
+    }
+    free(oldDB);
+  }
+
+  /** @brief Return the evaluator of a context, built on the first call.
+      Repeated calls from the same thread are served by the thread local cache.
+  */
   QualExprEvaluator & QualExprEvaluatorStack::getEvaluator(QualExprEvaluatorFrame &frame, Context_t context)
   {
-    QualExprEvaluator *result = NULL;
+    QualExprEvaluator *result = (QualExprEvaluator *) EvaluatorCache_t::find(m_cacheKey, context);
+    if (result) return *result;
+
     lock();
-    ContextNodeDB_t::iterator ite = m_contextDB.find(context);
-    unlock();
-    if (ite == m_contextDB.end()) {
+    result = findEvaluator(context);
+    if (!result) {
       result = new QualExprEvaluator(frame);
-      lock();
-      m_contextDB[context] = result;
-      unlock();
+      if (m_evaluatorList.size() >= m_contextBuckets) growDirectory();
+      ContextEntry_t *entry = new ContextEntry_t;
+      size_t slot = bucket(context);
+      entry->m_context = context;
+      entry->m_evaluator = result;
+      entry->m_next = m_contextDB[slot];
+      m_contextDB[slot] = entry;
+      m_evaluatorList.push_back(result);
     }
-    else result = ite->second;
+    EvaluatorCache_t::store(m_cacheKey, context, result);
+    unlock();
     return *result;
   }
 
+  /** @brief Return the evaluator of a context, which also receives the events sent to other contexts.
+   */
+  QualExprEvaluator & QualExprEvaluatorStack::addGlobalEvaluator(QualExprEvaluatorFrame &frame, Context_t context)
+  {
+    QualExprEvaluator &result = getEvaluator(frame, context);
+    lock();
+    if (!isGlobal(&result)) m_globalList.push_back(&result);
+    unlock();
+    return result;
+  }
+
   void QualExprEvaluatorStack::clearEvaluators(void)
   {
     lock();
-    for (ContextNodeDB_t::iterator ite = m_contextDB.begin(); ite != m_contextDB.end(); ite++) {
-      delete ite->second;
+    m_cacheKey = EvaluatorCache_t::newOwnerKey();
+    for(size_t index = 0; index < m_contextBuckets; index++) {
+      while (m_contextDB[index]) {
+        ContextEntry_t *entry = m_contextDB[index];
+        m_contextDB[index] = entry->m_next;
+        delete entry->m_evaluator;
+        delete entry;
+      }
     }
-    m_contextDB.clear();
+    m_evaluatorList.clear();
+    m_globalList.clear();
     unlock();
   }
 
   size_t QualExprEvaluatorStack::pushMeasure(const QualityExpressionEntry &qualExprEntry)
   {
     size_t size = 0;
-    for (ContextNodeDB_t::iterator ite = m_contextDB.begin(); ite != m_contextDB.end(); ite++) {
-      size += ite->second->pushMeasure(qualExprEntry);
+    for (EvaluatorList_t::iterator ite = m_evaluatorList.begin(); ite != m_evaluatorList.end(); ite++) {
+      size += (*ite)->pushMeasure(qualExprEntry);
     }
     return size;
   }
 
   void QualExprEvaluatorStack::resetMeasures(void)
   {
-    for (ContextNodeDB_t::iterator ite = m_contextDB.begin(); ite != m_contextDB.end(); ite++) {
-      ite->second->resetMeasures();
+    for (EvaluatorList_t::iterator ite = m_evaluatorList.begin(); ite != m_evaluatorList.end(); ite++) {
+      (*ite)->resetMeasures();
     }
   }
 
   void QualExprEvaluatorStack::consolidate(void) throw()
   {
-    for (ContextNodeDB_t::iterator ite = m_contextDB.begin(); ite != m_contextDB.end(); ite++) {
-      ite->second->consolidate();
+    for (EvaluatorList_t::iterator ite = m_evaluatorList.begin(); ite != m_evaluatorList.end(); ite++) {
+      (*ite)->consolidate();
+    }
+  }
+
+  /** @brief Lookup the evaluator of an event context.
+      The directory is read without lock: evaluators are only created and deleted while measures are stopped.
+  */
+  QualExprEvaluator * QualExprEvaluatorStack::routeEvaluator(Context_t context) const
+  {
+    QualExprEvaluator *result = (QualExprEvaluator *) EvaluatorCache_t::find(m_cacheKey, context);
+    if (result) return result;
+    result = findEvaluator(context);
+    if (result) EvaluatorCache_t::store(m_cacheKey, context, result);
+    return result;
+  }
+
+  bool QualExprEvaluatorStack::isGlobal(const QualExprEvaluator *evaluator) const
+  {
+    for (EvaluatorList_t::const_iterator ite = m_globalList.begin(); ite != m_globalList.end(); ite++) {
+      if (*ite == evaluator) return true;
+    }
+    return false;
+  }
+
+  void QualExprEvaluatorStack::routeEvents(const QualExprEvent *eventSem, size_t count) throw()
+  {
+    if (eventSem->m_context == QualExprEvent::NoContext) {
+      for (EvaluatorList_t::iterator ite = m_evaluatorList.begin(); ite != m_evaluatorList.end(); ite++) {
+        (*ite)->evaluateEvents(eventSem, count);
+      }
+      return;
+    }
+    QualExprEvaluator *evaluator = routeEvaluator(eventSem->m_context);
+    if (evaluator && !isGlobal(evaluator)) evaluator->evaluateEvents(eventSem, count);
+    for (EvaluatorList_t::iterator ite = m_globalList.begin(); ite != m_globalList.end(); ite++) {
+      (*ite)->evaluateEvents(eventSem, count);
     }
   }
 
   void QualExprEvaluatorStack::evaluateEvent(const QualExprEvent &eventSem) throw()
   {
-    for (ContextNodeDB_t::iterator ite = m_contextDB.begin(); ite != m_contextDB.end(); ite++) {
-      ite->second->evaluateEvent(eventSem);
+    routeEvents(&eventSem, 1);
+  }
+
+  /** @brief Dispatch a batch of events, consecutive events of the same context are dispatched together.
+   */
+  void QualExprEvaluatorStack::evaluateEvents(const QualExprEvent *eventSem, size_t count) throw()
+  {
+    size_t first = 0;
+    for (size_t index = 1; index <= count; index++) {
+      if (index == count || eventSem[index].m_context != eventSem[first].m_context) {
+        routeEvents(eventSem + first, index - first);
+        first = index;
+      }
     }
   }
 
@@ -557,7 +1578,8 @@ namespace quality_expressions_core
       Build all the data structures able to provide an event semantic or an aggregator.
   */
   /* Constructor */ QualExprEvaluator::QualExprEvaluator(QualExprEvaluatorFrame & frame) :
-    m_evaluationFrame(frame), m_semanticAggregatorDB(m_evaluationFrame.buildFrameAggregator()), m_computeNodeDB()
+    m_evaluationFrame(frame), m_semanticAggregatorDB(m_evaluationFrame.buildFrameAggregator()), m_computeNodeDB(),
+    m_computeDAG()
   {}
 
   /* Destructor */ QualExprEvaluator::~QualExprEvaluator(void)
@@ -569,9 +1591,32 @@ namespace quality_expressions_core
   {
     m_semanticAggregatorDB.clearMeasures();
     for (ComputeNodeDB_t::iterator ite = m_computeNodeDB.begin(); ite != m_computeNodeDB.end(); ite++) {
-      delete ite->second;
+      delete ite->second.m_node;
     }
     m_computeNodeDB.clear();
+    m_computeDAG.clear();
+  }
+
+  /** @brief Move the instructions of a compute program in the compute DAG.
+      Identical subexpressions of all the quality expressions are then computed once per read cycle.
+      Other compute nodes are returned unchanged.
+  */
+  QualExprComputeNode * QualExprEvaluator::share(QualExprComputeNode *computeNode)
+  {
+    QualExprComputeProgram<long64_t> *program = dynamic_cast<QualExprComputeProgram<long64_t> *>(computeNode);
+    if (!program) return computeNode;
+    QualExprComputeNode *sharedNode = m_computeDAG.share(*program);
+    delete program;
+    return sharedNode;
+  }
+
+  /** @brief Record a compute node under an entry ID.
+      The node type is checked once here, so the value readers do not need any cast.
+  */
+  void QualExprEvaluator::registerNode(QualityExpressionID_T entryID, QualExprComputeNode *computeNode)
+  {
+    ComputeEntry_t entry = { computeNode, dynamic_cast<QualExprComputeNodeOf<long64_t> *>(computeNode) };
+    m_computeNodeDB[entryID] = entry;
   }
 
   /** @brief Parse a quality expresion and register the corresponding aggregators.
@@ -595,7 +1640,7 @@ namespace quality_expressions_core
       if (newAggregNode) {
         count++;
       }
-      m_computeNodeDB[entryID] = newAggregNode;
+      registerNode(entryID, share(newAggregNode));
     } catch(QualExprEvaluatorFrame::Exception e) {
       throw(Exception(e));
     }
@@ -603,6 +1648,36 @@ namespace quality_expressions_core
     return count;
   }
 
+  /** @brief Provide the aggregators of a compiled quality expression. */
+  class QualExprEvaluatorBinder : public qe::binder
+  {
+  public:
+    /* Constructor */ QualExprEvaluatorBinder(QualExprEvaluator &evaluator) : m_evaluator(evaluator) {}
+    virtual qe::aggregator_t &	aggregator(const char *eventName, const char *aggregName)	{ return m_evaluator.pushSemanticAggregator(eventName, aggregName); }
+  private:
+    QualExprEvaluator &		m_evaluator;
+  };
+
+  /** @brief Bind the aggregators of a compiled quality expresion and register it with the entry ID.
+      The evaluator owns the expression, it is deleted if an exception is thrown.
+      @return the number of entries registered.
+  */
+  size_t QualExprEvaluator::pushStaticMeasure(QualityExpressionID_T entryID, qe::expression *expression) throw(QualExprEvaluator::Exception)
+  {
+    QualExprComputeNodeStatic *computeNode = new QualExprComputeNodeStatic(expression);
+    try {
+      if (m_computeNodeDB.find(entryID) != m_computeNodeDB.end()) throw(Exception("Quality expression ID already used"));
+      QualExprEvaluatorBinder binder(*this);
+      expression->bind(binder);
+    }
+    catch(Exception e) {
+      delete computeNode;
+      throw;
+    }
+    registerNode(entryID, computeNode);
+    return 1;
+  }
+
   /** @brief If possible improve data structures to speed-up event evaluations.
    */
   void QualExprEvaluator::consolidate(void) throw()
@@ -617,6 +1692,11 @@ namespace quality_expressions_core
     m_semanticAggregatorDB.evaluateEvent(event);
   }
 
+  void QualExprEvaluator::evaluateEvents(const QualExprEvent *events, size_t count) throw()
+  {
+    m_semanticAggregatorDB.evaluateEvents(events, count);
+  }
+
   /** @brief Display internal datastructures.
    */
   void QualExprEvaluator::display(const std::string &indent, std::stringstream &s) const
@@ -635,7 +1715,7 @@ namespace quality_expressions_core
     if (ite == m_computeNodeDB.end())
       throw(Exception("Quality expression not found"));
 
-    QualExprComputeNodeOf<long64_t> * node = dynamic_cast<QualExprComputeNodeOf<long64_t> *>(ite->second);
+    QualExprComputeNodeOf<long64_t> * node = ite->second.m_longNode;
     if (!node)
       throw(Exception("Quality expression not found value of wrong type"));
 
@@ -643,6 +1723,38 @@ namespace quality_expressions_core
     return value;
   }
 
+  /** @brief Retreive the values of several quality expressions by their IDs.
+      The value of an unknown ID, or of an expression of another type, is set to 0.
+      @return the number of values found.
+  */
+  size_t QualExprEvaluator::getLongCounters(const QualityExpressionID_T *ids, long64_t *values, size_t count) throw()
+  {
+    size_t found = 0;
+    for (size_t index = 0; index < count; index++) {
+      ComputeNodeDB_t::iterator ite = m_computeNodeDB.find(ids[index]);
+      QualExprComputeNodeOf<long64_t> * node = NULL;
+      if (ite != m_computeNodeDB.end()) node = ite->second.m_longNode;
+      if (node) { values[index] = node->eval(); found++; }
+      else values[index] = 0;
+    }
+    return found;
+  }
+
+  /** @brief Retreive the IDs and the values of all quality expressions, in increasing ID order.
+      At most count IDs and values are written, expressions of another type have the value 0.
+      @return the number of quality expressions.
+  */
+  size_t QualExprEvaluator::getAllLongCounters(QualityExpressionID_T *ids, long64_t *values, size_t count) throw()
+  {
+    size_t index = 0;
+    for (ComputeNodeDB_t::iterator ite = m_computeNodeDB.begin(); ite != m_computeNodeDB.end() && index < count; ite++, index++) {
+      QualExprComputeNodeOf<long64_t> * node = ite->second.m_longNode;
+      ids[index] = ite->first;
+      values[index] = node ? node->eval() : 0;
+    }
+    return m_computeNodeDB.size();
+  }
+
   /** @brief Remove a quality expression by its ID.
       Throw an exception if no aggregator is found with the given ID.
   */
@@ -652,7 +1764,7 @@ namespace quality_expressions_core
     if (ite == m_computeNodeDB.end())
       throw(Exception("Quality expression not found"));
 
-    delete ite->second;
+    delete ite->second.m_node;
     m_computeNodeDB.erase(ite);
   }
 
@@ -665,7 +1777,7 @@ namespace quality_expressions_core
     if (ite == m_computeNodeDB.end())
       throw(Exception("Quality expression not found"));
 
-    QualExprComputeNodeOf<long64_t> * node = dynamic_cast<QualExprComputeNodeOf<long64_t> *>(ite->second);
+    QualExprComputeNodeOf<long64_t> * node = ite->second.m_longNode;
     if (!node)
       throw(Exception("Quality expression not found value of wrong type"));
 
@@ -677,15 +1789,23 @@ namespace quality_expressions_core
   */
   QualExprComputeNodeOf<long64_t> * QualExprEvaluator::pushAggregator(const std::string &eventName, const std::string aggregName) throw(Exception)
   {
-    QualExprComputeNodeOf<long64_t> * newAggregNode = NULL;
+    return new QualExprComputeNodeAggreg<long64_t>(pushSemanticAggregator(eventName, aggregName));
+  }
+
+  /** @brief Add a semantic aggregator.
+      Throw an exception if the aggregator is unknown or does not compute long64_t values.
+  */
+  QualExprSemanticAggregator & QualExprEvaluator::pushSemanticAggregator(const std::string &eventName, const std::string aggregName) throw(Exception)
+  {
+    QualExprSemanticAggregator * newAggreg = NULL;
     try {
-      QualExprSemanticAggregator & newAggreg = m_semanticAggregatorDB.pushAggregator(eventName, aggregName);
-      newAggregNode = new QualExprComputeNodeAggreg<long64_t>(newAggreg);
+      newAggreg = &m_semanticAggregatorDB.pushAggregator(eventName, aggregName);
     }
     catch (QualExprSemanticAggregatorDB::Exception e) {
       throw(Exception(e.what()));
     }
-    return newAggregNode;
+    if (!newAggreg->evaluates<long64_t>()) throw(Exception("Aggregator value of wrong type: " + newAggreg->name()));
+    return *newAggreg;
   }
 
   /** @brief Add a compute node.
@@ -699,7 +1819,7 @@ namespace quality_expressions_core
       throw(Exception("Empty quality expression compute node"));
     }
 
-    m_computeNodeDB[entryID] = computeNode;
+    registerNode(entryID, share(computeNode));
   }
 
   /* ---------------------------------------------------------------------------------------------------------------- */
@@ -708,3 +1828,23 @@ namespace quality_expressions_core
   /* ---------------------------------------------------------------------------------------------------------------- */
 
 }
+
+/* ---------------------------------------------------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------------------------- */
+
+/** @brief Aggregator access for compiled quality expressions, their type is checked when they are bound.
+ */
+qe::value_t qe::evaluate(const qe::aggregator_t &aggreg)
+{
+  return aggreg.evaluate<qe::value_t>();
+}
+
+void qe::reset(qe::aggregator_t &aggreg)
+{
+  aggreg.reset();
+}
+
+void qe::display(const qe::aggregator_t &aggreg, std::stringstream &s)
+{
+  aggreg.display("", s);
+}
@@ -83,22 +83,7 @@ ifelse(BISON_VERSION, 23, %{, %code requires {)
     const std::string *	m_name;
   } aggregator_desc_t;
 
-  // Operator templates
-#define BIN_OPERATOR( name, computation, show )                                                                             \
-  template<typename kind> class name {                                                                                      \
-  public:	static inline kind compute(kind a, kind b)					{ return computation ; }    \
-  public:	static inline void display(const std::string &indent, std::stringstream &s)	{ show; }                   \
-  };
-
-BIN_OPERATOR( list,   a,  s << ';' );
-BIN_OPERATOR( lt,   a<b,  s << '<' );
-BIN_OPERATOR( gt,   a>b,  s << '>' );
-BIN_OPERATOR( le,   a<=b, s << "<=" );
-BIN_OPERATOR( ge,   a>=b, s << ">=" );
-BIN_OPERATOR( add,  a+b,  s << '+' );
-BIN_OPERATOR( sub,  a-b,  s << '-' );
-BIN_OPERATOR( mul,  a*b,  s << '*' );
-BIN_OPERATOR( divi, b!=0 ? a/b : 0,  s << '/' );
+  // Operator templates are defined with the compute nodes, see BIN_OPERATOR.
 
 ifelse(BISON_VERSION, 23, %}, })
 
@@ -291,6 +276,19 @@ namespace quality_expressions_core
     int error = parser.parse();
     end_parse();
     m_currentContext = NULL;
+    if (!error) lowerResult();
     return error;
   }
+
+  /** @brief Replace the compute tree built by the parser by a flat simplified program.
+   */
+  void QualExprEvaluatorParsingDriver::lowerResult(void)
+  {
+    QualExprComputeNodeOf<long64_t> *tree = dynamic_cast<QualExprComputeNodeOf<long64_t> *>(m_resultNode);
+    if (!tree) return;
+    QualExprComputeProgram<long64_t> *program = QualExprComputeProgram<long64_t>::compile(*tree);
+    program->simplify();
+    m_resultNode = program;
+    delete tree;
+  }
 }
@@ -0,0 +1,318 @@
+/**
+   @file    QualExprEventPipeline.cc
+   @ingroup QualityExpressionCore
+   @brief   Quality Expression asynchronous event pipeline implementation
+   @author  Laurent Morin
+   @verbatim
+   Revision:       $Revision$
+   Revision date:  $Date$
+   Committed by:   $Author$
+
+   This file is part of the Periscope performance measurement tool.
+   See http://www.lrr.in.tum.de/periscope for details.
+
+   Copyright (c) 2005-2014, Technische Universitaet Muenchen, Germany
+   See the COPYING file in the base directory of the package for details.
+
+   @endverbatim
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "qualexpr-evaluator/QualExprEventPipeline.h"
+
+namespace quality_expressions_core
+{
+/* ---------------------------------------------------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------------------------- */
+
+  /** @brief Ring constructor, the size is rounded up to a power of 2.
+      The ring is not valid if its storage can not be allocated.
+  */
+  /* Constructor */ QualExprEventRing::QualExprEventRing(size_t size, pthread_t owner) :
+    m_owner(owner), m_next(NULL), m_mask(1), m_records(NULL), m_head(0), m_tail(0)
+  {
+    while (m_mask < size) m_mask <<= 1;
+    m_records = (QualExprEventRecord *) malloc(m_mask * sizeof(QualExprEventRecord));
+    m_mask--;
+  }
+
+  /* Destructor */ QualExprEventRing::~QualExprEventRing(void)
+  {
+    free(m_records);
+  }
+
+  bool QualExprEventRing::push(const profiling_event_t &event, qualexpr_time_t timestamp, unsigned long context)
+  {
+    size_t tail = m_tail;
+    if (tail - m_head > m_mask) return false;
+    QualExprEventRecord &record = m_records[tail & m_mask];
+    record.m_event = event;
+    record.m_timestamp = timestamp;
+    record.m_context = context;
+    __sync_synchronize();
+    m_tail = tail + 1;
+    return true;
+  }
+
+  /** @brief Return the events available up to the end of the storage.
+      @return the number of events, the remaining part of a wrapped ring is returned by the next call.
+  */
+  size_t QualExprEventRing::front(QualExprEventRecord **records) const
+  {
+    size_t head = m_head;
+    size_t tail = m_tail;
+    __sync_synchronize();
+    size_t first = head & m_mask;
+    size_t count = tail - head;
+    if (first + count > m_mask + 1) count = m_mask + 1 - first;
+    *records = m_records + first;
+    return count;
+  }
+
+/* ---------------------------------------------------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------------------------- */
+
+  /** @brief Pipeline constructor, the drain thread is created with the pipeline.
+   */
+  /* Constructor */ QualExprEventPipeline::QualExprEventPipeline(QualExprEvaluatorStack &stack, QualExprEventBuilder &builder, size_t ringSize, overflow_policy_t policy) :
+    QualExprSemaphore(), m_stack(stack), m_builder(builder), m_ringSize(ringSize), m_policy(policy), m_ringList(NULL),
+    m_ringKey(RingCache_t::newOwnerKey()), m_dropped(0), m_parked(false), m_exiting(false), m_threaded(false), m_thread()
+  {
+    pthread_mutex_init(&m_parkLock, NULL);
+    pthread_cond_init(&m_wakeup, NULL);
+    pthread_cond_init(&m_drained, NULL);
+    m_threaded = !pthread_create(&m_thread, NULL, drainThread, this);
+  }
+
+  /** @brief Pipeline destruction, remaining events are aggregated before the drain thread terminates.
+   */
+  /* Destructor */ QualExprEventPipeline::~QualExprEventPipeline(void)
+  {
+    if (m_threaded) {
+      pthread_mutex_lock(&m_parkLock);
+      m_exiting = true;
+      pthread_cond_signal(&m_wakeup);
+      pthread_mutex_unlock(&m_parkLock);
+      pthread_join(m_thread, NULL);
+    }
+    else drain();
+    m_ringKey = RingCache_t::newOwnerKey();
+    while (m_ringList) {
+      QualExprEventRing *ring = m_ringList;
+      m_ringList = ring->m_next;
+      delete ring;
+    }
+    pthread_cond_destroy(&m_drained);
+    pthread_cond_destroy(&m_wakeup);
+    pthread_mutex_destroy(&m_parkLock);
+  }
+
+  /** @brief Build a pipeline if requested in the environment.
+      @sa QUALEXPR_ASYNC_RING_ENVNAME QUALEXPR_ASYNC_OVERFLOW_ENVNAME
+  */
+  QualExprEventPipeline * QualExprEventPipeline::buildFromEnvironment(QualExprEvaluatorStack &stack, QualExprEventBuilder &builder)
+  {
+    const char *env = getenv(QUALEXPR_ASYNC_RING_ENVNAME);
+    long ringSize = env ? atol(env) : 0;
+    if (ringSize <= 0) return NULL;
+
+    overflow_policy_t policy = O_BLOCK;
+    env = getenv(QUALEXPR_ASYNC_OVERFLOW_ENVNAME);
+    if (env && !strcmp(env, "drop")) policy = O_DROP;
+    return new QualExprEventPipeline(stack, builder, (size_t) ringSize, policy);
+  }
+
+  /** @brief Return the ring of the calling thread, built on the first event of the thread.
+      Rings are never deleted while the pipeline lives, a thread reusing a pthread_t reuses the ring.
+      @return NULL if the storage of the ring can not be allocated, the allocation is tried again on the next event.
+  */
+  QualExprEventRing * QualExprEventPipeline::threadRing(void)
+  {
+    QualExprEventRing *ring = (QualExprEventRing *) RingCache_t::find(m_ringKey, 0);
+    if (ring) return ring;
+
+    pthread_t self = pthread_self();
+    ring = m_ringList;
+    while (ring && !pthread_equal(ring->m_owner, self)) ring = ring->m_next;
+    if (!ring) {
+      ring = new QualExprEventRing(m_ringSize, self);
+      if (!ring->valid()) {
+        delete ring;
+        return NULL;
+      }
+      do { ring->m_next = m_ringList; } while (!atomic_cas(m_ringList, ring->m_next, ring));
+    }
+    RingCache_t::store(m_ringKey, 0, ring);
+    return ring;
+  }
+
+  /** @brief Push an event in the ring of the calling thread.
+      On a full ring, the producer waits for the drain or the event is dropped and counted. An event
+      without ring is dropped.
+  */
+  void QualExprEventPipeline::push(const profiling_event_t &event, qualexpr_time_t timestamp, unsigned long context)
+  {
+    QualExprEventRing *ring = threadRing();
+    if (!ring) { atomic_add<size_t>(m_dropped, 1); return; }
+    while (!ring->push(event, timestamp, context)) {
+      if (m_policy == O_DROP) { atomic_add<size_t>(m_dropped, 1); return; }
+      if (!m_threaded) drain();
+      else { wakeup(); sched_yield(); }
+    }
+    if (m_threaded) wakeup();
+  }
+
+  /** @brief Aggregate the available events in time stamp order.
+      The producer positions are read twice: events pushed before the first read are aggregated, with
+      all the events of other threads up to the latest of their time stamps, so an event is never
+      aggregated before the events it follows, e.g. the start of a region stopped by another thread.
+      Only one thread can drain at a time, the drain thread or a caller when it could not be created.
+  */
+  size_t QualExprEventPipeline::drain(void)
+  {
+    size_t total = 0;
+    lock();
+    m_cursors.clear();
+    QualExprEventRing *first = m_ringList;
+    for (QualExprEventRing *ring = first; ring; ring = ring->m_next) {
+      RingCursor_t cursor = { ring, ring->tail(), 0 };
+      m_cursors.push_back(cursor);
+    }
+    __sync_synchronize();
+    qualexpr_time_t horizon = 0;
+    for (size_t index = 0; index < m_cursors.size(); index++) {
+      RingCursor_t &cursor = m_cursors[index];
+      if (cursor.m_mark != cursor.m_ring->head() && cursor.m_ring->record(cursor.m_mark - 1).m_timestamp > horizon)
+        horizon = cursor.m_ring->record(cursor.m_mark - 1).m_timestamp;
+    }
+    for (QualExprEventRing *ring = m_ringList; ring != first; ring = ring->m_next) {
+      RingCursor_t cursor = { ring, ring->head(), 0 };
+      m_cursors.push_back(cursor);
+    }
+    size_t active = 0;
+    for (size_t index = 0; index < m_cursors.size(); index++) {
+      RingCursor_t &cursor = m_cursors[index];
+      cursor.m_limit = cursor.m_ring->tail();
+      if (cursor.m_limit != cursor.m_ring->head()) m_cursors[active++] = cursor;
+    }
+    m_cursors.resize(active);
+
+    for (;;) {
+      // -- Select the ring with the oldest event, and the time stamp of the next ring.
+      RingCursor_t *oldest = NULL, *next = NULL;
+      qualexpr_time_t oldestTime = 0, nextTime = 0;
+      for (size_t index = 0; index < m_cursors.size(); index++) {
+        RingCursor_t &cursor = m_cursors[index];
+        size_t head = cursor.m_ring->head();
+        if (head == cursor.m_limit) continue;
+        qualexpr_time_t timestamp = cursor.m_ring->record(head).m_timestamp;
+        if (head >= cursor.m_mark && timestamp > horizon) continue;
+        if (!oldest || timestamp < oldestTime) {
+          next = oldest;
+          nextTime = oldestTime;
+          oldest = &cursor;
+          oldestTime = timestamp;
+        }
+        else if (!next || timestamp < nextTime) {
+          next = &cursor;
+          nextTime = timestamp;
+        }
+      }
+      if (!oldest) break;
+
+      // -- Aggregate the contiguous events of the ring up to the next ring.
+      QualExprEventRing &ring = *oldest->m_ring;
+      QualExprEventRecord *records = NULL;
+      size_t available = ring.front(&records);
+      if (available > oldest->m_limit - ring.head()) available = oldest->m_limit - ring.head();
+      size_t count = 1;
+      for (size_t head = ring.head() + 1; count < available; count++, head++) {
+        qualexpr_time_t timestamp = records[count].m_timestamp;
+        if (next && timestamp > nextTime) break;
+        if (head >= oldest->m_mark && timestamp > horizon) break;
+      }
+      const QualExprEvent *eventSem = m_builder.pushRecords_threadLocal(records, count);
+      m_stack.evaluateEvents(eventSem, count);
+      m_builder.popEventsSequence_threadLocal(eventSem, count);
+      ring.pop(count);
+      total += count;
+    }
+    unlock();
+    return total;
+  }
+
+  bool QualExprEventPipeline::pending(void) const
+  {
+    for (const QualExprEventRing *ring = m_ringList; ring; ring = ring->m_next) {
+      if (ring->head() != ring->tail()) return true;
+    }
+    return false;
+  }
+
+  /** @brief Wake up the drain thread after an event is pushed.
+      The barrier orders the ring update before the read of the parking flag, while the drain thread sets
+      the flag before checking the rings: either the event is seen or the thread is signaled.
+  */
+  void QualExprEventPipeline::wakeup(void)
+  {
+    __sync_synchronize();
+    if (m_parked) {
+      pthread_mutex_lock(&m_parkLock);
+      pthread_cond_signal(&m_wakeup);
+      pthread_mutex_unlock(&m_parkLock);
+    }
+  }
+
+  /** @brief Drain thread main loop.
+      The thread parks when all rings are empty, and terminates with the pipeline once the rings are empty.
+  */
+  void * QualExprEventPipeline::drainThread(void *arg)
+  {
+    QualExprEventPipeline &pipeline = *((QualExprEventPipeline *) arg);
+    for (;;) {
+      size_t count = pipeline.drain();
+      pthread_mutex_lock(&pipeline.m_parkLock);
+      if (count) pthread_cond_broadcast(&pipeline.m_drained);
+      else if (pipeline.m_exiting) {
+        pthread_mutex_unlock(&pipeline.m_parkLock);
+        break;
+      }
+      else {
+        pipeline.m_parked = true;
+        __sync_synchronize();
+        if (!pipeline.pending()) pthread_cond_wait(&pipeline.m_wakeup, &pipeline.m_parkLock);
+        pipeline.m_parked = false;
+      }
+      pthread_mutex_unlock(&pipeline.m_parkLock);
+    }
+    return NULL;
+  }
+
+  /** @brief Wait until all events pushed before the call are aggregated by the drain thread.
+   */
+  void QualExprEventPipeline::flush(void)
+  {
+    if (!m_threaded) {
+      drain();
+      return;
+    }
+    for (QualExprEventRing *ring = m_ringList; ring; ring = ring->m_next) {
+      size_t tail = ring->tail();
+      if (ring->head() >= tail) continue;
+      pthread_mutex_lock(&m_parkLock);
+      while (ring->head() < tail) {
+        pthread_cond_signal(&m_wakeup);
+        pthread_cond_wait(&m_drained, &m_parkLock);
+      }
+      pthread_mutex_unlock(&m_parkLock);
+    }
+  }
+
+}
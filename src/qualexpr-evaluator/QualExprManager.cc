@@ -29,6 +29,8 @@
 
 namespace quality_expressions_core
 {
+  static __thread unsigned long g_activeContext = QualExprEvent::NoContext;	//!< Context of the events of the calling thread.
+
 /* ---------------------------------------------------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------------------------------------------------- */
@@ -40,16 +42,20 @@ namespace quality_expressions_core
       for the current thread.
    */
   /* Constructor */ QualExprManager::QualExprManager(void) throw() :
-    QualExprSemaphore(), m_state(S_OFF), m_timer(), m_eventBuilder(m_timer)
+    QualExprSemaphore(), m_state(S_OFF), m_timer(QualExprTimer::buildFromEnvironment()), m_eventBuilder(*m_timer), m_eventPipeline(NULL)
   {
     evaluateVerbosityLevel();
+    m_eventPipeline = QualExprEventPipeline::buildFromEnvironment(m_evaluatorStack, m_eventBuilder);
   }
 
   /** @brief Quality Expression Manager destruction
       Warning: the clear method must be called before.
    */
   /* Destructor */ QualExprManager::~QualExprManager(void)
-  {}
+  {
+    delete m_eventPipeline;
+    delete m_timer;
+  }
 
   /** @brief Quality expression evaluator Initializations
    */
@@ -206,6 +212,39 @@ namespace quality_expressions_core
     return rcount;
   }
 
+  /** @brief Append a compiled quality expresion.
+      The manager owns the expression, it is deleted if an exception is thrown.
+      @param contextId the context
+      @param id    the quality expresion ID
+      @param expression the compiled quality expresion
+      @return      the number of expression item registered
+   */
+  size_t QualExprManager::addStaticCounter(Context_t contextId, QualityExpressionID_T id, qe::expression *expression) throw(QualExprManager::Exception)
+  {
+    size_t rcount = 0;
+    if (m_state == S_REGISTERED) {
+      QualExprEvaluator & evaluator = m_evaluatorStack.getEvaluator(m_evaluatorFrame, contextId);
+      try {
+        rcount = evaluator.pushStaticMeasure(id, expression);
+      }
+      catch(QualExprEvaluator::Exception e) {
+        display(evaluator);
+        throw(Exception(e.what()));
+      }
+      if (m_debugLevel >= D_ON) {
+        std::stringstream msg;
+        msg << "New compiled quality expression (id:" << id << "): ";
+        expression->display(msg);
+        log(msg.str());
+      }
+    }
+    else {
+      delete expression;
+      throw(Exception("Profiler not initialized or already activated"));
+    }
+    return rcount;
+  }
+
   /** @brief Get the result of a quality expresion evaluation.
       @param tid thread id
       @param id  the quality expresion ID
@@ -214,6 +253,7 @@ namespace quality_expressions_core
   long long QualExprManager::getLongCounter(Context_t contextId, QualityExpressionID_T id) throw(QualExprManager::Exception)
   {
     if (m_state == S_REGISTERED) {
+      if (m_eventPipeline) m_eventPipeline->flush();
       QualExprEvaluator & evaluator = m_evaluatorStack.getEvaluator(m_evaluatorFrame, contextId);
       long long result = 0;
       try {
@@ -233,6 +273,53 @@ namespace quality_expressions_core
     else throw(Exception("Profiler not initialized or already activated"));
   }
 
+  /** @brief Get the results of several quality expresion evaluations.
+      The context is resolved once, unknown IDs get the value 0.
+      @param contextId the context
+      @param ids    the quality expresion IDs
+      @param values the values, one per ID
+      @param count  the number of IDs
+      @return       the number of values found
+   */
+  size_t QualExprManager::getLongCounters(Context_t contextId, const QualityExpressionID_T *ids, long long *values, size_t count) throw(QualExprManager::Exception)
+  {
+    if (m_state == S_REGISTERED) {
+      if (m_eventPipeline) m_eventPipeline->flush();
+      QualExprEvaluator & evaluator = m_evaluatorStack.getEvaluator(m_evaluatorFrame, contextId);
+      size_t found = evaluator.getLongCounters(ids, values, count);
+      if (m_debugLevel >= D_FULLEVENTS) {
+        std::stringstream msg;
+        msg << "Fetch " << found << " quality expressions (of " << count << ")";
+        log(msg.str());
+      }
+      return found;
+    }
+    else throw(Exception("Profiler not initialized or already activated"));
+  }
+
+  /** @brief Get the IDs and results of all the quality expresions of a context, in increasing ID order.
+      @param contextId the context
+      @param ids    the quality expresion IDs
+      @param values the values, one per ID
+      @param count  the size of the arrays, at most count IDs and values are written
+      @return       the number of quality expresions of the context
+   */
+  size_t QualExprManager::getAllLongCounters(Context_t contextId, QualityExpressionID_T *ids, long long *values, size_t count) throw(QualExprManager::Exception)
+  {
+    if (m_state == S_REGISTERED) {
+      if (m_eventPipeline) m_eventPipeline->flush();
+      QualExprEvaluator & evaluator = m_evaluatorStack.getEvaluator(m_evaluatorFrame, contextId);
+      size_t size = evaluator.getAllLongCounters(ids, values, count);
+      if (m_debugLevel >= D_FULLEVENTS) {
+        std::stringstream msg;
+        msg << "Fetch all " << size << " quality expressions";
+        log(msg.str());
+      }
+      return size;
+    }
+    else throw(Exception("Profiler not initialized or already activated"));
+  }
+
   /** @brief Reset the result of a quality expresion evaluation.
       @param tid thread id
       @param id  the quality expresion ID
@@ -358,17 +445,27 @@ namespace quality_expressions_core
     else throw(Exception("Profiler not initialized or already activated"));
   }
 
+  /** @brief Make a context receive the events sent to all other contexts.
+      @param contextId the context, built if needed
+   */
+  void QualExprManager::addGlobalContext(Context_t contextId) throw(QualExprManager::Exception)
+  {
+    if (m_state == S_REGISTERED) {
+      m_evaluatorStack.addGlobalEvaluator(m_evaluatorFrame, contextId);
+    }
+    else throw(Exception("Profiler not initialized or already activated"));
+  }
+
   /** @brief Enable measurements.
       @param tid   thread id
   */
   void QualExprManager::enableMeasures(void)
   {
     if (m_state == S_REGISTERED || m_state == S_ON) {
+      m_evaluatorStack.consolidate();
       m_state = S_ON;
     }
     else throw(Exception("Profiler not initialized"));
-
-    m_evaluatorStack.consolidate();
   }
 
   /** @brief Disable measurements.
@@ -378,23 +475,67 @@ namespace quality_expressions_core
   {
     if (m_state == S_ON) {
       m_state = S_REGISTERED;
+      if (m_eventPipeline) {
+        m_eventPipeline->flush();
+        if (m_eventPipeline->dropped() && m_debugLevel >= D_ON) {
+          std::stringstream msg;
+          msg << "Events dropped on ring overflow: " << m_eventPipeline->dropped();
+          log(msg.str());
+        }
+      }
     }
     else throw(Exception("Profiler not activated"));
   }
 
   /** @brief Handle an event for quality expressions.
+      No lock is taken: events are aggregated in the replicas of the calling thread,
+      or only time stamped and pushed to the asynchronous pipeline.
    */
   void QualExprManager::event(profiling_event_t * event) throw()
   {
     if (event && m_state == S_ON) {
-
-      lock();
-      const QualExprEvent &eventSem = m_eventBuilder.pushEvent_singleThread(event);
+      if (m_eventPipeline) {
+        m_eventPipeline->push(*event, m_timer->timestamp(), g_activeContext);
+        return;
+      }
+      const QualExprEvent &eventSem = m_eventBuilder.pushEvent_threadLocal(event, g_activeContext);
       m_evaluatorStack.evaluateEvent(eventSem);
 
-      m_eventBuilder.popEventSequence_singleThread(eventSem);
-      unlock();
+      m_eventBuilder.popEventSequence_threadLocal(eventSem);
+    }
+  }
+
+  /** @brief Handle a batch of events for quality expressions.
+      The events are time stamped once, then dispatched in a single pass over the evaluators.
+   */
+  void QualExprManager::events(profiling_event_t * events, size_t count) throw()
+  {
+    if (events && count && m_state == S_ON) {
+      if (m_eventPipeline) {
+        qualexpr_time_t timestamp = m_timer->timestamp();
+        for (size_t index = 0; index < count; index++) m_eventPipeline->push(events[index], timestamp, g_activeContext);
+        return;
+      }
+      const QualExprEvent *eventSem = m_eventBuilder.pushEvents_threadLocal(events, count, g_activeContext);
+      m_evaluatorStack.evaluateEvents(eventSem, count);
+
+      m_eventBuilder.popEventsSequence_threadLocal(eventSem, count);
     }
   }
 
+  /** @brief Route the next events of the calling thread to one context.
+      The events are evaluated by the evaluator of this context and by the global contexts only.
+   */
+  void QualExprManager::setActiveContext(Context_t contextId) throw()
+  {
+    g_activeContext = contextId;
+  }
+
+  /** @brief Send the next events of the calling thread to all contexts.
+   */
+  void QualExprManager::clearActiveContext(void) throw()
+  {
+    g_activeContext = QualExprEvent::NoContext;
+  }
+
 } // namespace quality_expressions_core
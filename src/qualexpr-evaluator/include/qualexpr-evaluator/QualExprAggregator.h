@@ -20,10 +20,14 @@
 #ifndef QUALEXP_AGGREGATOR_H_
 #define QUALEXP_AGGREGATOR_H_
 
+#include <stdlib.h>
+
 #include "qualexpr-profiler/QualExprProfiler.h"
 
 namespace quality_expressions_core
 {
+  class QualExprLanes;
+
   /**
      @class QualExprAggregator
      @brief Interface for the definition of a particular aggregator.
@@ -32,22 +36,152 @@ namespace quality_expressions_core
   class QualExprAggregator
   {
   protected:
-    /* Constructor */ 			QualExprAggregator(size_t id) : m_id(id) {}		//!< Pure interface, no direct constructor.
+    /* Constructor */ 			QualExprAggregator(size_t id) : m_id(id), m_version(0), m_versionSlot(&m_version) {}	//!< Pure interface, no direct constructor.
   public:
     /* Constructor */ virtual		~QualExprAggregator(void) {}
 
     size_t				getId(void) const		{ return m_id; }	//!< Aggregator unique ID.
+    unsigned long			version(void) const		{ return *m_versionSlot; }	//!< Number of events aggregated, used to detect updates.
+    void				aggregate(const QualExprEvent &event)	{ processEvent(event); (*m_versionSlot)++; }	//!< Aggregate the given event and bump the version.
     virtual const char *		name(void) const = 0;					//!< Aggregator fully qualified name.
     virtual const char *		description(void) const = 0;				//!< Display a description of the aggregator - debug.
 
     virtual void			processEvent(const QualExprEvent &event) = 0;		//!< Aggregate the given event.
     virtual QualExprAggregator *	build(size_t id) const = 0;				//!< Operate as an aggregator constructor node.
+    virtual QualExprAggregator *	replicate(void) const		{ return build(getId()); }	//!< Build a thread replica, sharing with this aggregator the state that must be seen by all threads.
+    virtual QualExprAggregator *	buildFromName(const std::string &name, size_t id) const	{ return name == this->name() ? build(id) : NULL; }	//!< Build an aggregator if the name is handled by the constructor node, NULL otherwise.
     virtual void			reset(void) = 0;					//!< Reset the aggregator state.
+    virtual void			merge(const QualExprAggregator &replica) = 0;		//!< Merge the state of a replica of the same kind, built with build().
 
     virtual void			display(const std::string &indent, std::stringstream &s) const = 0;	//!< Display debugging information about the object.
 
+  public: // -- Lane API, see QualExprLanes
+    enum lane_t { LANE_NONE = 0, LANE_SUM, LANE_MAX, LANE_MIN };							//!< Accumulation of the values in a lane.
+
+    virtual lane_t			lane(void) const		{ return LANE_NONE; }	//!< Accumulation of the aggregator, LANE_NONE if its state can not be stored in a lane.
+    virtual const char *		laneSource(void) const		{ return NULL; }	//!< Name of the values accumulated, equal for the aggregators sampling the same values.
+    virtual bool			laneSample(const QualExprEvent &event, long long &value)	{ return false; }	//!< Value of an event for the lanes of the source.
+    virtual void			bindLane(QualExprLanes *lanes, size_t lane)	{}		//!< Move the state in a lane, or back in the object if lanes is NULL.
+
+  protected:
+    /** @brief Move the update counter in a lane, or back in the object if slot is NULL. */
+    void				bindVersion(unsigned long *slot)	{ if (!slot) slot = &m_version; *slot = *m_versionSlot; m_versionSlot = slot; }
+
   private:
     size_t				m_id;		//!< Unique aggregator id.
+    unsigned long			m_version;	//!< Update counter, only written by the thread aggregating events.
+    unsigned long *			m_versionSlot;	//!< Storage of the update counter, m_version or a lane.
+  };
+
+  /**
+     @class QualExprLanes
+     @brief State of the accumulations of a thread, in arrays.
+     @ingroup QualityExpressionEvaluation
+
+     Replicas accumulating a count and a value by sum, maximum or minimum store them with their version in a
+     lane of these arrays. A run of events is sampled once per source, and the samples are accumulated in a
+     range of consecutive lanes by loops the compiler can vectorize, instead of a virtual call per replica
+     and per event.
+  */
+  class QualExprLanes
+  {
+  public:
+    /* Constructor */ QualExprLanes(size_t size);
+    /* Destructor */ ~QualExprLanes(void);
+
+    void				accumulate(QualExprAggregator::lane_t lane, size_t begin, size_t end, const long long *samples, size_t count, size_t events);	//!< Accumulate samples of a run of events in lanes [begin, end[.
+
+  public:
+    size_t *				m_counts;		//!< Number of values of each lane.
+    long long *				m_values;		//!< Accumulated value of each lane.
+    unsigned long *			m_versions;		//!< Update counter of each lane.
+
+  private:
+    /* Constructor */ QualExprLanes(const QualExprLanes &);	//!< Not copyable.
+    QualExprLanes &			operator=(const QualExprLanes &);
+  };
+
+  /**
+     @class QualExprOpenIntervals
+     @brief Started events waiting for their stop event, indexed by event ID.
+     @ingroup QualityExpressionEvaluation
+
+     Open addressing table with linear probing, grown on demand up to MAX_SIZE entries. When the
+     table is full, the oldest started event is considered as abandoned and is forgotten.
+  */
+  class QualExprOpenIntervals
+  {
+  public:
+    /* Constructor */ QualExprOpenIntervals(void) : m_entries(NULL), m_size(0), m_count(0) {}
+    /* Destructor */ ~QualExprOpenIntervals(void)	{ free(m_entries); }
+
+    void				open(unsigned int eid, qualexpr_time_t timestamp, long long value);	//!< Record a started event.
+    bool				close(unsigned int eid, qualexpr_time_t &timestamp, long long &value);	//!< Remove a started event, false if unknown.
+    size_t				size(void) const		{ return m_count; }			//!< Number of started events.
+
+  private:
+    enum { MIN_SIZE = 8, MAX_SIZE = 4096 };
+
+    typedef struct entry_t {
+      unsigned int			m_eid;			//!< Event ID.
+      bool				m_used;			//!< Entry holding a started event.
+      qualexpr_time_t			m_timestamp;		//!< Time stamp of the start event.
+      long long				m_value;		//!< Value of the start event.
+    } entry_t;
+
+    size_t				slot(unsigned int eid) const	{ return (eid * 0x9E3779B1U) & (m_size - 1); }
+    void				resize(size_t size);		//!< Rebuild the table with a new size.
+    void				erase(size_t index);		//!< Remove an entry, keeping probe sequences contiguous.
+    void				evictOldest(void);		//!< Forget the oldest started event.
+
+  private:
+    entry_t *				m_entries;		//!< Table, NULL before the first started event.
+    size_t				m_size;			//!< Number of entries, a power of 2.
+    size_t				m_count;		//!< Number of used entries.
+
+  private:
+    /* Constructor */ QualExprOpenIntervals(const QualExprOpenIntervals &);	//!< Not copyable.
+    QualExprOpenIntervals &		operator=(const QualExprOpenIntervals &);
+  };
+
+  /**
+     @class QualExprSharedIntervals
+     @brief Started events waiting for their stop event, shared by the thread replicas of an aggregator.
+     @ingroup QualityExpressionEvaluation
+
+     An event may be stopped by another thread than the one which started it, so the replicas of a
+     semantic aggregator pair their events in the table of the aggregator they are replicated from.
+     Events are spread by ID over STRIPES tables, each with its own lock. The tables are allocated on
+     the first started event, by the aggregator owning them.
+  */
+  class QualExprSharedIntervals
+  {
+  public:
+    /* Constructor */ QualExprSharedIntervals(void) : m_stripes(NULL), m_owner(true) {}
+    /* Destructor */ ~QualExprSharedIntervals(void)	{ if (m_owner) delete [] m_stripes; }
+
+    void				share(const QualExprSharedIntervals &owner)	{ m_stripes = owner.stripes(); m_owner = false; }	//!< Use the tables of another aggregator.
+    void				open(unsigned int eid, qualexpr_time_t timestamp, long long value);	//!< Record a started event.
+    bool				close(unsigned int eid, qualexpr_time_t &timestamp, long long &value);	//!< Remove a started event, false if unknown.
+
+  private:
+    enum { STRIPES = 16 };
+
+    typedef struct stripe_t {
+      QualExprSemaphore			m_lock;			//!< Protect the table.
+      QualExprOpenIntervals		m_intervals;		//!< Started events of the stripe.
+    } stripe_t;
+
+    stripe_t *				stripes(void) const;		//!< Tables, allocated on the first call.
+    stripe_t &				stripe(unsigned int eid)	{ return (m_stripes ? m_stripes : stripes())[eid & (STRIPES - 1)]; }
+
+  private:
+    mutable stripe_t *			m_stripes;		//!< Tables, NULL before the first started event.
+    bool				m_owner;		//!< The tables are freed with the object.
+
+  private:
+    /* Constructor */ QualExprSharedIntervals(const QualExprSharedIntervals &);	//!< Not copyable.
+    QualExprSharedIntervals &		operator=(const QualExprSharedIntervals &);
   };
 
 }
@@ -22,6 +22,7 @@
 
 #include "qualexpr-evaluator/QualExprAggregator.h"
 #include "qualexpr-evaluator/QualExprAggregatorNamespace.h"
+#include "qualexpr-evaluator/QualExprAggregatorStatistics.h"
 
 namespace quality_expressions_core
 {
@@ -48,15 +49,23 @@ namespace quality_expressions_core
   {
   protected:
     /* Constructor */ QualExprAggregatorBandwidth(size_t id, bool r=false) :
-      QualExprAggregatorEvalBasic<long64_t>(id) {}
+      QualExprAggregatorEvalBasic<long64_t>(id), m_openIntervals() {}
 
   public:
     static void	    registerToAggregatorNS(QualExprAggregatorNamespace &aggregNs);
+    virtual QualExprAggregator * replicate(void) const;	//!< Build a thread replica pairing its events in the table of this aggregator.
 
   protected:
-    unsigned int	m_previousEid;			//!< Previous event ID (for relating start/stop events of the same time).
-    long64_t		m_previousTimeStamp;		//!< Timestamp of the previous event.
-    double		m_currentSize;			//!< Size of the current event.
+    bool		bandwidth(const QualExprEvent &event, long64_t &bandwidth);	//!< Match start and stop events, true with the bandwidth on a stop event ending after its start.
+    bool		sample(const QualExprEvent &event, long64_t &value)		{ return bandwidth(event, value); }	//!< Value of an event for the statistic aggregators.
+    static const char *	label(void)							{ return "bandwidth"; }			//!< Name of the values.
+
+  public: // -- Lane API
+    virtual const char *laneSource(void) const						{ return label(); }			//!< Bandwidths are sampled for the lanes.
+    virtual bool	laneSample(const QualExprEvent &event, long64_t &value)		{ return bandwidth(event, value); }	//!< Bandwidth of a stop event.
+
+  protected:
+    QualExprSharedIntervals	m_openIntervals;		//!< Started events with their size, for relating start/stop events of the same instance, shared with the replicas.
   };
 
   /**
@@ -78,6 +87,8 @@ namespace quality_expressions_core
     virtual const char *			name(void) const						{ return "~bw"; }                                       //!< Aggregator fully qualified name.
     virtual const char *			description(void) const						{ return "Average bandwidth"; }                         //!< Aggregator description.
     virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorBandwidthAverage(id); }  //!< Auto-constructor.
+    virtual void				merge(const QualExprAggregator &replica)			{ mergeSum(static_cast<const QualExprAggregatorBandwidthAverage &>(replica)); }	//!< Merge a replica.
+    virtual lane_t				lane(void) const						{ return LANE_SUM; }				//!< Accumulation of the lane.
   };
 
   /**
@@ -99,6 +110,8 @@ namespace quality_expressions_core
     virtual const char *			name(void) const						{ return "+bw"; }                                       //!< Aggregator fully qualified name.
     virtual const char *			description(void) const						{ return "Max bandwidth"; }                             //!< Aggregator description.
     virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorBandwidthMax(id); }      //!< Auto-constructor.
+    virtual void				merge(const QualExprAggregator &replica)			{ mergeMax(static_cast<const QualExprAggregatorBandwidthMax &>(replica)); }	//!< Merge a replica.
+    virtual lane_t				lane(void) const						{ return LANE_MAX; }				//!< Accumulation of the lane.
   };
 
   /**
@@ -120,7 +133,9 @@ namespace quality_expressions_core
     virtual const char *			name(void) const						{ return "-bw"; }                                       //!< Aggregator fully qualified name.
     virtual const char *			description(void) const						{ return "Min bandwidth"; }                             //!< Aggregator description.
     virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorBandwidthMin(id); }      //!< Auto-constructor.
-    virtual void				reset(void)							{ m_value = -1; m_count = 0; }				//!< Reset the aggregator state.
+    virtual void				merge(const QualExprAggregator &replica)			{ mergeMin(static_cast<const QualExprAggregatorBandwidthMin &>(replica)); }	//!< Merge a replica.
+    virtual lane_t				lane(void) const						{ return LANE_MIN; }				//!< Accumulation of the lane.
+    virtual void				reset(void)							{ value() = -1; count() = 0; }				//!< Reset the aggregator state.
   };
 
 }
@@ -52,25 +52,47 @@ namespace quality_expressions_core
   template <typename kind> class QualExprAggregatorEvalBasic: public QualExprAggregatorEval<kind>
   {
   protected:
-    /* Constructor */ QualExprAggregatorEvalBasic(size_t id) : QualExprAggregatorEval<kind>(id), m_count(0), m_value(0) {}
+    /* Constructor */ QualExprAggregatorEvalBasic(size_t id) : QualExprAggregatorEval<kind>(id), m_countSlot(&m_count), m_valueSlot(&m_value), m_count(0), m_value(0) {}
 
   protected: // -- Evaluation API
-    virtual kind		average(void) const	{ return m_count ? m_value / m_count : 0; }	//!< Average is the value per aggregation occurences.
-    virtual kind		value(void) const	{ return m_value; }				//!< Current aggregation value - by value.
-    virtual size_t		count(void) const	{ return m_count; }				//!< Aggregation occurences - by value.
-    virtual kind &		value(void)		{ return m_value; }				//!< Current aggregation value - by reference.
-    virtual size_t &		count(void)		{ return m_count; }				//!< Aggregation occurences - by reference.
-    virtual void		reset(void)		{ m_value = 0; m_count = 0; }			//!< Reset the aggregator state.
+    virtual kind		average(void) const	{ return count() ? value() / count() : 0; }	//!< Average is the value per aggregation occurences.
+    virtual kind		value(void) const	{ return *m_valueSlot; }			//!< Current aggregation value - by value.
+    virtual size_t		count(void) const	{ return *m_countSlot; }			//!< Aggregation occurences - by value.
+    virtual kind &		value(void)		{ return *m_valueSlot; }			//!< Current aggregation value - by reference.
+    virtual size_t &		count(void)		{ return *m_countSlot; }			//!< Aggregation occurences - by reference.
+    virtual void		reset(void)		{ value() = 0; count() = 0; }			//!< Reset the aggregator state.
+
+  protected: // -- Replica merging API
+    /** @brief Merge rule for accumulations: values and occurences are added. */
+    void			mergeSum(const QualExprAggregatorEvalBasic<kind> &replica)	{ value() += replica.value(); count() += replica.count(); }
+    /** @brief Merge rule for maximums, empty replicas are ignored. */
+    void			mergeMax(const QualExprAggregatorEvalBasic<kind> &replica)	{ if (replica.count() && (!count() || value() < replica.value())) value() = replica.value(); count() += replica.count(); }
+    /** @brief Merge rule for minimums, empty replicas are ignored. */
+    void			mergeMin(const QualExprAggregatorEvalBasic<kind> &replica)	{ if (replica.count() && (!count() || value() > replica.value())) value() = replica.value(); count() += replica.count(); }
+
+  public: // -- Lane API
+    /** @brief Move the count, the value and the version in a lane, or back in the object if lanes is NULL. */
+    virtual void		bindLane(QualExprLanes *lanes, size_t lane) {
+      size_t *countSlot = lanes ? &lanes->m_counts[lane] : &m_count;
+      kind *valueSlot = lanes ? &lanes->m_values[lane] : &m_value;
+      *countSlot = count();
+      *valueSlot = value();
+      m_countSlot = countSlot;
+      m_valueSlot = valueSlot;
+      this->bindVersion(lanes ? &lanes->m_versions[lane] : NULL);
+    }
 
   public: // -- Access API
     /** @brief Display debugging information about the object. */
     virtual void		display(const std::string &indent, std::stringstream &s) const {
-      s<<indent<<"<"<<std::setprecision(24)<<m_value<<">"<<"["<<std::setprecision(24)<<m_count<<"]";
+      s<<indent<<"<"<<std::setprecision(24)<<value()<<">"<<"["<<std::setprecision(24)<<count()<<"]";
     }
 
-  protected:
-    size_t		m_count;			//!< Number of events.
-    kind		m_value;			//!< The current aggregation value.
+  private:
+    size_t *		m_countSlot;			//!< Storage of the number of events, m_count or a lane.
+    kind *		m_valueSlot;			//!< Storage of the aggregation value, m_value or a lane.
+    size_t		m_count;			//!< Number of events, when not stored in a lane.
+    kind		m_value;			//!< The current aggregation value, when not stored in a lane.
   };
 
 }
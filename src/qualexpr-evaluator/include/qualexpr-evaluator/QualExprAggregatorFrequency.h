@@ -0,0 +1,99 @@
+/**
+   @file    QualExprAggregatorFrequency.h
+   @ingroup QualityExpressionEvaluation
+   @brief   Evaluation of quality expressions - frequency of event values
+   @author  Laurent Morin
+   @verbatim
+   Revision:       $Revision$
+   Revision date:  $Date$
+   Committed by:   $Author$
+
+   This file is part of the Periscope performance measurement tool.
+   See http://www.lrr.in.tum.de/periscope for details.
+
+   Copyright (c) 2005-2014, Technische Universitaet Muenchen, Germany
+   See the COPYING file in the base directory of the package for details.
+
+   @endverbatim
+*/
+
+#ifndef QUALEXP_AGGREGATOR_FREQUENCY_H_
+#define QUALEXP_AGGREGATOR_FREQUENCY_H_
+
+#include "qualexpr-evaluator/QualExprAggregator.h"
+#include "qualexpr-evaluator/QualExprAggregatorNamespace.h"
+#include "qualexpr-evaluator/QualExprAggregatorSketch.h"
+
+namespace quality_expressions_core
+{
+  // -- Some predefined types for aggregators.
+  typedef long long long64_t;
+
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+
+  /**
+   * @defgroup QualExprAggregatorFrequency Frequency aggregators
+   * Group of aggregator counting the occurences of each event value, whatever it stands for: a message size, a region instance...
+   * @ingroup QualityExpressionEvaluation
+  */
+
+  /**
+     @class QualExprAggregatorFrequency
+     @brief Base class for frequency based aggregators
+     @ingroup QualExprAggregatorFrequency
+  */
+  class QualExprAggregatorFrequency: public QualExprAggregatorEval<long64_t>
+  {
+  protected:
+    /* Constructor */ QualExprAggregatorFrequency(size_t id) : QualExprAggregatorEval<long64_t>(id) {}
+
+  public:
+    static void	    registerToAggregatorNS(QualExprAggregatorNamespace &aggregNs);	//!< Record all aggregators in the group in the namespace.
+  };
+
+  /**
+     @class QualExprAggregatorFrequencySketch
+     @brief Heavy hitters of the values of start and counter events, estimated with a count-min sketch.
+     @ingroup QualExprAggregatorFrequency
+
+     The aggregator names carry a parameter:
+     - "|freq-<value>": estimated number of events of the given value,
+     - "|top-<rank>": value of the given rank in the most frequent values, from 1,
+     - "|top-count-<rank>": estimated number of events of the value of the given rank.
+  */
+  class QualExprAggregatorFrequencySketch: public QualExprAggregatorFrequency
+  {
+  public:
+    enum query_t { Q_FREQUENCY = 0, Q_TOP_VALUE, Q_TOP_COUNT };	//!< Value evaluated from the sketch.
+
+  public:
+    /* Constructor */        QualExprAggregatorFrequencySketch(size_t id, query_t query, long long parameter, const std::string &name) :
+      QualExprAggregatorFrequency(id), m_sketch(), m_query(query), m_parameter(parameter), m_name(name)					{ reset(); }
+    /* Constructor */        QualExprAggregatorFrequencySketch(QualExprAggregatorNamespace &aggregNs, query_t query, const char *prefix) :
+      QualExprAggregatorFrequency(0), m_sketch(), m_query(query), m_parameter(0), m_name(prefix)						{ aggregNs.registerNewAggregator('|', this); }
+    /* Destructor */ virtual ~QualExprAggregatorFrequencySketch(void) {}
+
+  public:
+    virtual void				display(const std::string &indent, std::stringstream &s) const;
+    virtual void				processEvent(const QualExprEvent &event);										//!< Aggregate the given event.
+    virtual long64_t				evaluate(void) const;											//!< Aggregator evaluation.
+    virtual const char *			name(void) const						{ return m_name.c_str(); }				//!< Aggregator fully qualified name.
+    virtual const char *			description(void) const						{ return "Frequent values"; }				//!< Aggregator description.
+    virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorFrequencySketch(id, m_query, m_parameter, m_name); }	//!< Auto-constructor.
+    virtual QualExprAggregator *		buildFromName(const std::string &name, size_t id) const;						//!< Build the aggregator of a name made of the prefix and the parameter.
+    virtual void				merge(const QualExprAggregator &replica)			{ m_sketch.merge(static_cast<const QualExprAggregatorFrequencySketch &>(replica).m_sketch); }	//!< Merge a replica.
+    virtual void				reset(void)							{ m_sketch.reset(); }					//!< Reset the aggregator state.
+
+  private:
+    QualExprCountMinSketch			m_sketch;			//!< Sketch of the values.
+    query_t					m_query;			//!< Value evaluated.
+    long long					m_parameter;			//!< Value or rank queried.
+    std::string					m_name;				//!< Full aggregator name, the name prefix for a constructor node.
+  };
+
+}
+
+#endif
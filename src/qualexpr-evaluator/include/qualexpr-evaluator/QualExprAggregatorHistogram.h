@@ -0,0 +1,85 @@
+/**
+   @file    QualExprAggregatorHistogram.h
+   @ingroup QualityExpressionEvaluation
+   @brief   Evaluation of quality expressions - log-linear histograms for quantile aggregators
+   @author  Laurent Morin
+   @verbatim
+   Revision:       $Revision$
+   Revision date:  $Date$
+   Committed by:   $Author$
+
+   This file is part of the Periscope performance measurement tool.
+   See http://www.lrr.in.tum.de/periscope for details.
+
+   Copyright (c) 2005-2014, Technische Universitaet Muenchen, Germany
+   See the COPYING file in the base directory of the package for details.
+
+   @endverbatim
+*/
+
+#ifndef QUALEXP_AGGREGATOR_HISTOGRAM_H_
+#define QUALEXP_AGGREGATOR_HISTOGRAM_H_
+
+#include <string.h>
+
+namespace quality_expressions_core
+{
+  /**
+     @class QualExprHistogram
+     @brief Fixed size log-linear histogram of positive values.
+     @ingroup QualityExpressionEvaluation
+
+     Values below 2^PRECISION have their own bucket, each following power of 2 is split in
+     2^PRECISION buckets of equal width. A quantile is known within 1/2^(PRECISION+1) of its value,
+     3% with the default precision. Recording is a constant time bucket increment, the storage
+     is part of the object and never allocated.
+  */
+  class QualExprHistogram
+  {
+  public:
+    enum {
+      PRECISION	= 4,					//!< Number of bits of the value kept by the bucket index.
+      LINEAR	= 1 << PRECISION,			//!< Number of buckets per power of 2.
+      BUCKETS	= (64 - PRECISION) * LINEAR		//!< Number of buckets covering all positive 64 bits values.
+    };
+
+  public:
+    /* Constructor */ QualExprHistogram(void)		{ reset(); }
+
+    /** @brief Record a value, negative values are recorded as 0. */
+    void		record(long long value) {
+      if (value < 0) value = 0;
+      if (!m_count || value < m_min) m_min = value;
+      if (!m_count || value > m_max) m_max = value;
+      m_buckets[bucket(value)]++;
+      m_count++;
+    }
+    void		reset(void)				{ memset(m_buckets, 0, sizeof(m_buckets)); m_count = 0; m_min = 0; m_max = 0; }	//!< Forget all values.
+    void		merge(const QualExprHistogram &replica);	//!< Add the values of another histogram.
+    long long		quantile(unsigned int permille) const;		//!< Value of the quantile, given in 1/1000.
+    size_t		count(void) const			{ return m_count; }	//!< Number of values recorded.
+
+  private:
+    /** @brief Bucket of a positive value. */
+    static size_t	bucket(long long value) {
+      if (value < LINEAR) return (size_t) value;
+      size_t shift = 63 - __builtin_clzll((unsigned long long) value) - PRECISION;
+      return (shift + 1) * LINEAR + (size_t) ((value >> shift) - LINEAR);
+    }
+    /** @brief Smallest value of a bucket. */
+    static long long	lowerBound(size_t index) {
+      if (index < LINEAR) return (long long) index;
+      size_t shift = index / LINEAR - 1;
+      return (long long) (LINEAR + index % LINEAR) << shift;
+    }
+
+  private:
+    unsigned int	m_buckets[BUCKETS];		//!< Number of values per bucket.
+    size_t		m_count;			//!< Number of values.
+    long long		m_min;				//!< Exact smallest value.
+    long long		m_max;				//!< Exact largest value.
+  };
+
+}
+
+#endif
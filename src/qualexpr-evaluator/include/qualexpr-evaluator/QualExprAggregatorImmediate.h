@@ -51,8 +51,8 @@ namespace quality_expressions_core
   class QualExprAggregatorImmediate: public QualExprAggregatorEval<long64_t>
   {
   public:
-    /* Constructor */        QualExprAggregatorImmediate(size_t id) : QualExprAggregatorEval<long64_t>(id), m_value(0) {}
-    /* Constructor */        QualExprAggregatorImmediate(QualExprAggregatorNamespace &aggregNs) : QualExprAggregatorEval<long64_t>(0), m_value(0)	{ aggregNs.registerNewAggregator('!', this); }
+    /* Constructor */        QualExprAggregatorImmediate(size_t id) : QualExprAggregatorEval<long64_t>(id), m_value(0), m_timestamp(0) {}
+    /* Constructor */        QualExprAggregatorImmediate(QualExprAggregatorNamespace &aggregNs) : QualExprAggregatorEval<long64_t>(0), m_value(0), m_timestamp(0)	{ aggregNs.registerNewAggregator('!', this); }
     /* Destructor */ virtual ~QualExprAggregatorImmediate(void) {}
 
   public:
@@ -65,10 +65,12 @@ namespace quality_expressions_core
     virtual const char *			name(void) const							{ return "!"; }						//!< Aggregator fully qualified name.
     virtual const char *			description(void) const							{ return "Immediate"; }					//!< Aggregator description.
     virtual QualExprAggregator *		build(size_t id) const							{ return new QualExprAggregatorImmediate(id); }		//!< Auto-constructor.
-    virtual void				reset(void)								{ m_value = 0; }					//!< Reset the aggregator state.
+    virtual void				reset(void)								{ m_value = 0; m_timestamp = 0; }			//!< Reset the aggregator state.
+    virtual void				merge(const QualExprAggregator &replica);										//!< Keep the most recent immediate value.
 
   protected:
     long64_t	m_value;			//!< Immediate value of the counter or event.
+    qualexpr_time_t	m_timestamp;			//!< Time stamp of the immediate value, used to merge replicas.
   };
 
 }
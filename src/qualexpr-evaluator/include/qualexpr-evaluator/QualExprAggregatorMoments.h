@@ -0,0 +1,62 @@
+/**
+   @file    QualExprAggregatorMoments.h
+   @ingroup QualityExpressionEvaluation
+   @brief   Evaluation of quality expressions - streaming moments for dispersion aggregators
+   @author  Laurent Morin
+   @verbatim
+   Revision:       $Revision$
+   Revision date:  $Date$
+   Committed by:   $Author$
+
+   This file is part of the Periscope performance measurement tool.
+   See http://www.lrr.in.tum.de/periscope for details.
+
+   Copyright (c) 2005-2014, Technische Universitaet Muenchen, Germany
+   See the COPYING file in the base directory of the package for details.
+
+   @endverbatim
+*/
+
+#ifndef QUALEXP_AGGREGATOR_MOMENTS_H_
+#define QUALEXP_AGGREGATOR_MOMENTS_H_
+
+#include <stddef.h>
+
+namespace quality_expressions_core
+{
+  /**
+     @class QualExprMoments
+     @brief Streaming mean and variance of a series of values.
+     @ingroup QualityExpressionEvaluation
+
+     Values are accumulated with the Welford update, partial states of replicas are combined with
+     the pairwise rule of Chan et al., both avoid the cancellation of the sum of squares method.
+  */
+  class QualExprMoments
+  {
+  public:
+    /* Constructor */ QualExprMoments(void) : m_count(0), m_mean(0), m_m2(0) {}
+
+    /** @brief Record a value. */
+    void		record(double value) {
+      m_count++;
+      double delta = value - m_mean;
+      m_mean += delta / m_count;
+      m_m2 += delta * (value - m_mean);
+    }
+    void		reset(void)				{ m_count = 0; m_mean = 0; m_m2 = 0; }		//!< Forget all values.
+    void		merge(const QualExprMoments &replica);						//!< Combine with the moments of another series.
+    double		variance(void) const			{ return m_count ? m_m2 / m_count : 0; }	//!< Population variance.
+    double		stddev(void) const;								//!< Population standard deviation.
+    double		mean(void) const			{ return m_mean; }				//!< Mean of the values.
+    size_t		count(void) const			{ return m_count; }				//!< Number of values recorded.
+
+  private:
+    size_t		m_count;			//!< Number of values.
+    double		m_mean;				//!< Running mean.
+    double		m_m2;				//!< Sum of the squared distances to the mean.
+  };
+
+}
+
+#endif
@@ -22,6 +22,7 @@
 
 #include "qualexpr-evaluator/QualExprAggregator.h"
 #include "qualexpr-evaluator/QualExprAggregatorNamespace.h"
+#include "qualexpr-evaluator/QualExprAggregatorStatistics.h"
 
 namespace quality_expressions_core
 {
@@ -52,6 +53,19 @@ namespace quality_expressions_core
 
   public:
     static void	    registerToAggregatorNS(QualExprAggregatorNamespace &aggregNs);	//!< Record all aggregators in the group in the namespace.
+
+  protected:
+    /** @brief Value of an event for the statistic aggregators: the size of start and counter events. */
+    bool	    sample(const QualExprEvent &event, long64_t &value)	{ if (event.m_state != D_START && event.m_state != D_COUNTER) return false; value = event.m_value; return true; }
+    static const char *label(void)					{ return "size"; }	//!< Name of the values.
+
+  public: // -- Lane API
+    virtual const char *laneSource(void) const				{ return label(); }				//!< Sizes of start and counter events are sampled for the lanes.
+    virtual bool	laneSample(const QualExprEvent &event, long64_t &value)	{ return sample(event, value); }		//!< Size of a start or counter event.
+
+  protected:
+    /** @brief Value of an event for the maximum and minimum: the size of start events only. */
+    static bool	    startSize(const QualExprEvent &event, long64_t &value)	{ if (event.m_state != D_START) return false; value = event.m_value; return true; }
   };
 
   /**
@@ -73,6 +87,8 @@ namespace quality_expressions_core
     virtual const char *			name(void) const						{ return "|size"; }                             //!< Aggregator fully qualified name.
     virtual const char *			description(void) const						{ return "Accumulated size"; }                  //!< Aggregator description.
     virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorSizeSum(id); }   //!< Auto-constructor.
+    virtual void				merge(const QualExprAggregator &replica)			{ mergeSum(static_cast<const QualExprAggregatorSizeSum &>(replica)); }	//!< Merge a replica.
+    virtual lane_t				lane(void) const						{ return LANE_SUM; }				//!< Accumulation of the lane.
   };
 
   /**
@@ -114,6 +130,10 @@ namespace quality_expressions_core
     virtual const char *			name(void) const						{ return "+size"; }                             //!< Aggregator fully qualified name.
     virtual const char *			description(void) const						{ return "Max size"; }                          //!< Aggregator description.
     virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorSizeMax(id); }   //!< Auto-constructor.
+    virtual void				merge(const QualExprAggregator &replica)			{ mergeMax(static_cast<const QualExprAggregatorSizeMax &>(replica)); }	//!< Merge a replica.
+    virtual lane_t				lane(void) const						{ return LANE_MAX; }				//!< Accumulation of the lane.
+    virtual const char *			laneSource(void) const						{ return "size-start"; }				//!< Sizes of start events are sampled for the lanes.
+    virtual bool				laneSample(const QualExprEvent &event, long64_t &value)		{ return startSize(event, value); }			//!< Size of a start event.
   };
 
   /**
@@ -135,7 +155,11 @@ namespace quality_expressions_core
     virtual const char *			name(void) const						{ return "-size"; }                                     //!< Aggregator fully qualified name.
     virtual const char *			description(void) const						{ return "Min size"; }                                  //!< Aggregator description.
     virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorSizeMin(id); }           //!< Auto-constructor.
-    virtual void				reset(void)							{ m_value = -1; m_count = 0; }				//!< Reset the aggregator state.
+    virtual void				merge(const QualExprAggregator &replica)			{ mergeMin(static_cast<const QualExprAggregatorSizeMin &>(replica)); }	//!< Merge a replica.
+    virtual lane_t				lane(void) const						{ return LANE_MIN; }				//!< Accumulation of the lane.
+    virtual const char *			laneSource(void) const						{ return "size-start"; }				//!< Sizes of start events are sampled for the lanes.
+    virtual bool				laneSample(const QualExprEvent &event, long64_t &value)		{ return startSize(event, value); }			//!< Size of a start event.
+    virtual void				reset(void)							{ value() = -1; count() = 0; }				//!< Reset the aggregator state.
   };
 
 }
@@ -0,0 +1,74 @@
+/**
+   @file    QualExprAggregatorSketch.h
+   @ingroup QualityExpressionEvaluation
+   @brief   Evaluation of quality expressions - count-min sketch for heavy hitter aggregators
+   @author  Laurent Morin
+   @verbatim
+   Revision:       $Revision$
+   Revision date:  $Date$
+   Committed by:   $Author$
+
+   This file is part of the Periscope performance measurement tool.
+   See http://www.lrr.in.tum.de/periscope for details.
+
+   Copyright (c) 2005-2014, Technische Universitaet Muenchen, Germany
+   See the COPYING file in the base directory of the package for details.
+
+   @endverbatim
+*/
+
+
+#ifndef QUALEXP_AGGREGATOR_SKETCH_H_
+#define QUALEXP_AGGREGATOR_SKETCH_H_
+
+#include <stddef.h>
+
+namespace quality_expressions_core
+{
+  /**
+     @class QualExprCountMinSketch
+     @brief Count-min sketch of event values, with the list of the most frequent values.
+     @ingroup QualityExpressionEvaluation
+
+     A value increments one counter in each of the DEPTH rows, its frequency is estimated by the
+     smallest of these counters: the estimate is never below the real frequency and exceeds it by at
+     most e/WIDTH of the number of values with a high probability. The TOP values of highest estimate
+     are kept in a fixed list, updated with the estimate of each recorded value. The storage is part of
+     the object, recording never allocates.
+  */
+  class QualExprCountMinSketch
+  {
+  public:
+    enum {
+      DEPTH	= 4,					//!< Number of rows, i.e. of hash functions.
+      WIDTH	= 512,					//!< Number of counters per row.
+      TOP	= 16					//!< Number of frequent values tracked.
+    };
+
+  public:
+    /* Constructor */ QualExprCountMinSketch(void)		{ reset(); }
+
+    void		record(long long value);				//!< Record a value.
+    void		reset(void);						//!< Forget all values.
+    void		merge(const QualExprCountMinSketch &replica);		//!< Add the values of another sketch.
+    size_t		estimate(long long value) const;			//!< Estimated frequency of a value.
+    bool		top(size_t rank, long long &value, size_t &count) const;	//!< Value and estimate of the given rank, from 1, false if unknown.
+
+  private:
+    typedef struct heavy_t {
+      long long			m_value;		//!< Frequent value.
+      size_t			m_count;		//!< Estimated frequency.
+    } heavy_t;
+
+    static size_t	cell(size_t row, long long value);		//!< Counter of a value in a row.
+    void		offer(long long value, size_t count);		//!< Update the list of frequent values with an estimate.
+
+  private:
+    unsigned int	m_cells[DEPTH][WIDTH];		//!< Counters.
+    heavy_t		m_top[TOP];			//!< Most frequent values, unordered.
+    size_t		m_topSize;			//!< Number of frequent values.
+  };
+
+}
+
+#endif
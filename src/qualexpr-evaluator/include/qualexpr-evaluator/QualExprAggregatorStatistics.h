@@ -0,0 +1,180 @@
+/**
+   @file    QualExprAggregatorStatistics.h
+   @ingroup QualityExpressionEvaluation
+   @brief   Evaluation of quality expressions - statistic aggregators shared by the aggregator families
+   @author  Laurent Morin
+   @verbatim
+   Revision:       $Revision$
+   Revision date:  $Date$
+   Committed by:   $Author$
+
+   This file is part of the Periscope performance measurement tool.
+   See http://www.lrr.in.tum.de/periscope for details.
+
+   Copyright (c) 2005-2014, Technische Universitaet Muenchen, Germany
+   See the COPYING file in the base directory of the package for details.
+
+   @endverbatim
+*/
+
+#ifndef QUALEXP_AGGREGATOR_STATISTICS_H_
+#define QUALEXP_AGGREGATOR_STATISTICS_H_
+
+#include "qualexpr-evaluator/QualExprAggregator.h"
+#include "qualexpr-evaluator/QualExprAggregatorNamespace.h"
+#include "qualexpr-evaluator/QualExprAggregatorHistogram.h"
+#include "qualexpr-evaluator/QualExprAggregatorMoments.h"
+#include "qualexpr-evaluator/QualExprAggregatorWindow.h"
+
+namespace quality_expressions_core
+{
+  // -- Some predefined types for aggregators.
+  typedef long long long64_t;
+
+  /*
+    The statistic aggregators are defined once for all families. A family is the base class of its
+    aggregators and provides:
+    - bool sample(const QualExprEvent &event, long64_t &value): the value of an event, false if the event has none,
+    - static const char *label(void): the name of the values, for the display.
+  */
+
+  /**
+     @class QualExprAggregatorQuantile
+     @brief Quantile of the values of a family, e.g. "|p99" or "|size-p99".
+     @param family The aggregator family providing the values.
+     @ingroup QualityExpressionEvaluation
+
+     Values are recorded in a log-linear histogram, one prototype is registered per quantile.
+  */
+  template <class family> class QualExprAggregatorQuantile: public family
+  {
+  public:
+    /* Constructor */        QualExprAggregatorQuantile(size_t id, unsigned int permille, const char *name) : family(id), m_histogram(), m_permille(permille), m_name(name) { reset(); }
+    /* Constructor */        QualExprAggregatorQuantile(QualExprAggregatorNamespace &aggregNs, unsigned int permille, const char *name) :
+      family(0), m_histogram(), m_permille(permille), m_name(name)												{ aggregNs.registerNewAggregator('|', this); }
+    /* Destructor */ virtual ~QualExprAggregatorQuantile(void) {}
+
+  public:
+    virtual void				processEvent(const QualExprEvent &event)			{ long64_t value; if (this->sample(event, value)) m_histogram.record(value); }	//!< Aggregate the given event.
+    virtual long64_t				evaluate(void) const						{ return m_histogram.quantile(m_permille); }		//!< Aggregator evaluation.
+    virtual const char *			name(void) const						{ return m_name; }					//!< Aggregator fully qualified name.
+    virtual const char *			description(void) const						{ return "Quantile"; }					//!< Aggregator description.
+    virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorQuantile<family>(id, m_permille, m_name); }	//!< Auto-constructor.
+    virtual void				merge(const QualExprAggregator &replica)			{ m_histogram.merge(static_cast<const QualExprAggregatorQuantile<family> &>(replica).m_histogram); }	//!< Merge a replica.
+    virtual void				reset(void)							{ m_histogram.reset(); }				//!< Reset the aggregator state.
+    /** @brief Display debugging information about the object. */
+    virtual void				display(const std::string &indent, std::stringstream &s) const {
+      s << indent << " " << family::label() << " quantile " << m_permille / 10.0 << "%=" << std::setprecision(24) << evaluate() << " in " << m_histogram.count() << " calls";
+    }
+
+  private:
+    QualExprHistogram				m_histogram;			//!< Distribution of the values.
+    unsigned int				m_permille;			//!< Quantile computed, in 1/1000.
+    const char *				m_name;				//!< Aggregator name, a static string.
+  };
+
+  /**
+     @class QualExprAggregatorVariance
+     @brief Variance or standard deviation of the values of a family, e.g. "|var" and "|stddev".
+     @param family The aggregator family providing the values.
+     @ingroup QualityExpressionEvaluation
+  */
+  template <class family> class QualExprAggregatorVariance: public family
+  {
+  public:
+    /* Constructor */        QualExprAggregatorVariance(size_t id, bool stddev, const char *name) : family(id), m_moments(), m_stddev(stddev), m_name(name) { reset(); }
+    /* Constructor */        QualExprAggregatorVariance(QualExprAggregatorNamespace &aggregNs, bool stddev, const char *name) :
+      family(0), m_moments(), m_stddev(stddev), m_name(name)													{ aggregNs.registerNewAggregator('|', this); }
+    /* Destructor */ virtual ~QualExprAggregatorVariance(void) {}
+
+  public:
+    virtual void				processEvent(const QualExprEvent &event)			{ long64_t value; if (this->sample(event, value)) m_moments.record(value); }	//!< Aggregate the given event.
+    virtual long64_t				evaluate(void) const						{ return (long64_t) ((m_stddev ? m_moments.stddev() : m_moments.variance()) + 0.5); }	//!< Aggregator evaluation.
+    virtual const char *			name(void) const						{ return m_name; }					//!< Aggregator fully qualified name.
+    virtual const char *			description(void) const						{ return m_stddev ? "Standard deviation" : "Variance"; }	//!< Aggregator description.
+    virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorVariance<family>(id, m_stddev, m_name); }	//!< Auto-constructor.
+    virtual void				merge(const QualExprAggregator &replica)			{ m_moments.merge(static_cast<const QualExprAggregatorVariance<family> &>(replica).m_moments); }	//!< Merge a replica.
+    virtual void				reset(void)							{ m_moments.reset(); }					//!< Reset the aggregator state.
+    /** @brief Display debugging information about the object. */
+    virtual void				display(const std::string &indent, std::stringstream &s) const {
+      s << indent << " " << family::label() << " " << (m_stddev ? "stddev" : "variance") << "=" << std::setprecision(24) << evaluate() << " in " << m_moments.count() << " calls";
+    }
+
+  private:
+    QualExprMoments				m_moments;			//!< Streaming moments of the values.
+    bool					m_stddev;			//!< Evaluate the standard deviation instead of the variance.
+    const char *				m_name;				//!< Aggregator name, a static string.
+  };
+
+  /**
+     @class QualExprAggregatorWindow
+     @brief Sum or number of the values of a family over the last period, e.g. "|time-10s" and "|size-count-10s".
+     @param family The aggregator family providing the values.
+     @ingroup QualityExpressionEvaluation
+  */
+  template <class family> class QualExprAggregatorWindow: public family
+  {
+  public:
+    /* Constructor */        QualExprAggregatorWindow(size_t id, qualexpr_time_t period, bool count, const char *name) :
+      family(id), m_window(period), m_period(period), m_counting(count), m_name(name)									{ reset(); }
+    /* Constructor */        QualExprAggregatorWindow(QualExprAggregatorNamespace &aggregNs, qualexpr_time_t period, bool count, const char *name) :
+      family(0), m_window(period), m_period(period), m_counting(count), m_name(name)									{ aggregNs.registerNewAggregator('|', this); }
+    /* Destructor */ virtual ~QualExprAggregatorWindow(void) {}
+
+  public:
+    virtual void				processEvent(const QualExprEvent &event)			{ long64_t value; if (this->sample(event, value)) m_window.record(event.m_timestamp, value); }	//!< Aggregate the given event.
+    virtual long64_t				evaluate(void) const						{ return m_counting ? m_window.count() : m_window.sum(); }	//!< Aggregator evaluation.
+    virtual const char *			name(void) const						{ return m_name; }					//!< Aggregator fully qualified name.
+    virtual const char *			description(void) const						{ return m_counting ? "Events in a sliding window" : "Values accumulated in a sliding window"; }	//!< Aggregator description.
+    virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorWindow<family>(id, m_period, m_counting, m_name); }	//!< Auto-constructor.
+    virtual void				merge(const QualExprAggregator &replica)			{ m_window.merge(static_cast<const QualExprAggregatorWindow<family> &>(replica).m_window); }	//!< Merge a replica.
+    virtual void				reset(void)							{ m_window.reset(); }					//!< Reset the aggregator state.
+    /** @brief Display debugging information about the object. */
+    virtual void				display(const std::string &indent, std::stringstream &s) const {
+      s << indent << " " << family::label() << (m_counting ? " count" : " sum") << " over " << m_period / 1e9 << "s=" << std::setprecision(24) << evaluate();
+    }
+
+  private:
+    QualExprSlidingWindow			m_window;			//!< Recent values.
+    qualexpr_time_t				m_period;			//!< Window duration in nanoseconds.
+    bool					m_counting;			//!< Evaluate the number of events instead of the sum.
+    const char *				m_name;				//!< Aggregator name, a static string.
+  };
+
+  /**
+     @class QualExprAggregatorDecayed
+     @brief Exponentially weighted moving average of the values of a family, e.g. "~time-10s".
+     @param family The aggregator family providing the values.
+     @ingroup QualityExpressionEvaluation
+  */
+  template <class family> class QualExprAggregatorDecayed: public family
+  {
+  public:
+    /* Constructor */        QualExprAggregatorDecayed(size_t id, qualexpr_time_t period, const char *name) :
+      family(id), m_average(period), m_period(period), m_name(name)											{ reset(); }
+    /* Constructor */        QualExprAggregatorDecayed(QualExprAggregatorNamespace &aggregNs, qualexpr_time_t period, const char *name) :
+      family(0), m_average(period), m_period(period), m_name(name)											{ aggregNs.registerNewAggregator('~', this); }
+    /* Destructor */ virtual ~QualExprAggregatorDecayed(void) {}
+
+  public:
+    virtual void				processEvent(const QualExprEvent &event)			{ long64_t value; if (this->sample(event, value)) m_average.record(event.m_timestamp, value); }	//!< Aggregate the given event.
+    virtual long64_t				evaluate(void) const						{ return m_average.average(); }			//!< Aggregator evaluation.
+    virtual const char *			name(void) const						{ return m_name; }					//!< Aggregator fully qualified name.
+    virtual const char *			description(void) const						{ return "Moving average"; }				//!< Aggregator description.
+    virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorDecayed<family>(id, m_period, m_name); }	//!< Auto-constructor.
+    virtual void				merge(const QualExprAggregator &replica)			{ m_average.merge(static_cast<const QualExprAggregatorDecayed<family> &>(replica).m_average); }	//!< Merge a replica.
+    virtual void				reset(void)							{ m_average.reset(); }					//!< Reset the aggregator state.
+    /** @brief Display debugging information about the object. */
+    virtual void				display(const std::string &indent, std::stringstream &s) const {
+      s << indent << " " << family::label() << " moving average over " << m_period / 1e9 << "s=" << std::setprecision(24) << evaluate();
+    }
+
+  private:
+    QualExprDecayedAverage			m_average;			//!< Decayed average of the values.
+    qualexpr_time_t				m_period;			//!< Time constant in nanoseconds.
+    const char *				m_name;				//!< Aggregator name, a static string.
+  };
+
+}
+
+#endif
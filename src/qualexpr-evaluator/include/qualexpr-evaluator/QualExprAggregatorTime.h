@@ -22,6 +22,7 @@
 
 #include "qualexpr-evaluator/QualExprAggregator.h"
 #include "qualexpr-evaluator/QualExprAggregatorNamespace.h"
+#include "qualexpr-evaluator/QualExprAggregatorStatistics.h"
 
 namespace quality_expressions_core
 {
@@ -48,14 +49,23 @@ namespace quality_expressions_core
   {
   protected:
     /* Constructor */ QualExprAggregatorTime(size_t id, bool r=false) :
-      QualExprAggregatorEvalBasic<long64_t>(id), m_previousEid(0), m_previousTimeStamp(0) {}
+      QualExprAggregatorEvalBasic<long64_t>(id), m_openIntervals() {}
 
   public:
     static void			registerToAggregatorNS(QualExprAggregatorNamespace &aggregNs);		//!< Record all aggregators in the group in the namespace.
+    virtual QualExprAggregator *	replicate(void) const;		//!< Build a thread replica pairing its events in the table of this aggregator.
 
   protected:
-    unsigned int		m_previousEid;			//!< Previous event ID (for relating start/stop events of the same time).
-    long64_t			m_previousTimeStamp;		//!< Timestamp of the previous event.
+    bool			duration(const QualExprEvent &event, long64_t &duration);	//!< Match start and stop events, true with the duration on a stop event.
+    bool			sample(const QualExprEvent &event, long64_t &value)		{ return duration(event, value); }	//!< Value of an event for the statistic aggregators.
+    static const char *		label(void)							{ return "time"; }			//!< Name of the values.
+
+  public: // -- Lane API
+    virtual const char *	laneSource(void) const						{ return label(); }			//!< Durations are sampled for the lanes.
+    virtual bool		laneSample(const QualExprEvent &event, long64_t &value)		{ return duration(event, value); }	//!< Duration of a stop event.
+
+  protected:
+    QualExprSharedIntervals	m_openIntervals;		//!< Started events, for relating start/stop events of the same instance, shared with the replicas.
   };
 
   /**
@@ -77,6 +87,8 @@ namespace quality_expressions_core
     virtual const char *			name(void) const							{ return "~time"; }					//!< Aggregator fully qualified name.
     virtual const char *			description(void) const							{ return "Average time"; }				//!< Aggregator description.
     virtual QualExprAggregator *		build(size_t id) const							{ return new QualExprAggregatorTimeAverage(id); }	//!< Auto-constructor.
+    virtual void				merge(const QualExprAggregator &replica)			{ mergeSum(static_cast<const QualExprAggregatorTimeAverage &>(replica)); }	//!< Merge a replica.
+    virtual lane_t				lane(void) const						{ return LANE_SUM; }				//!< Accumulation of the lane.
   };
 
   /**
@@ -98,6 +110,8 @@ namespace quality_expressions_core
     virtual const char *			name(void) const						{ return "+time"; }                                     //!< Aggregator fully qualified name.
     virtual const char *			description(void) const						{ return "Maximum time"; }                              //!< Aggregator description.
     virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorTimeMax(id); }           //!< Auto-constructor.
+    virtual void				merge(const QualExprAggregator &replica)			{ mergeMax(static_cast<const QualExprAggregatorTimeMax &>(replica)); }	//!< Merge a replica.
+    virtual lane_t				lane(void) const						{ return LANE_MAX; }				//!< Accumulation of the lane.
   };
 
   /**
@@ -119,7 +133,9 @@ namespace quality_expressions_core
     virtual const char *			name(void) const						{ return "-time"; }                                     //!< Aggregator fully qualified name.
     virtual const char *			description(void) const						{ return "Minimum time"; }                              //!< Aggregator description.
     virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorTimeMin(id); }           //!< Auto-constructor.
-    virtual void				reset(void)							{ m_value = -1; m_count = 0; }				//!< Reset the aggregator state.
+    virtual void				merge(const QualExprAggregator &replica)			{ mergeMin(static_cast<const QualExprAggregatorTimeMin &>(replica)); }	//!< Merge a replica.
+    virtual lane_t				lane(void) const						{ return LANE_MIN; }				//!< Accumulation of the lane.
+    virtual void				reset(void)							{ value() = -1; count() = 0; }				//!< Reset the aggregator state.
   };
 
   /**
@@ -141,6 +157,8 @@ namespace quality_expressions_core
     virtual const char *			name(void) const						{ return "|time"; }                                     //!< Aggregator fully qualified name.
     virtual const char *			description(void) const						{ return "Accumulated time"; }                          //!< Aggregator description.
     virtual QualExprAggregator *		build(size_t id) const						{ return new QualExprAggregatorTimeSum(id); }           //!< Auto-constructor.
+    virtual void				merge(const QualExprAggregator &replica)			{ mergeSum(static_cast<const QualExprAggregatorTimeSum &>(replica)); }	//!< Merge a replica.
+    virtual lane_t				lane(void) const						{ return LANE_SUM; }				//!< Accumulation of the lane.
   };
 
 }
@@ -0,0 +1,97 @@
+/**
+   @file    QualExprAggregatorWindow.h
+   @ingroup QualityExpressionEvaluation
+   @brief   Evaluation of quality expressions - sliding windows and time-decayed averages
+   @author  Laurent Morin
+   @verbatim
+   Revision:       $Revision$
+   Revision date:  $Date$
+   Committed by:   $Author$
+
+   This file is part of the Periscope performance measurement tool.
+   See http://www.lrr.in.tum.de/periscope for details.
+
+   Copyright (c) 2005-2014, Technische Universitaet Muenchen, Germany
+   See the COPYING file in the base directory of the package for details.
+
+   @endverbatim
+*/
+
+#ifndef QUALEXP_AGGREGATOR_WINDOW_H_
+#define QUALEXP_AGGREGATOR_WINDOW_H_
+
+#include "qualexpr-profiler/QualExprProfiler.h"
+
+namespace quality_expressions_core
+{
+  /**
+     @class QualExprSlidingWindow
+     @brief Sum and number of the values recorded during the last period.
+     @ingroup QualityExpressionEvaluation
+
+     The period is split in SLOTS slots, each tagged with the index of the time slice it holds. A
+     slot is recycled when a value of a newer slice falls on it, so no clean up is needed and the
+     memory is constant. The window ends at the most recent event time stamp seen and covers the
+     period within one slot.
+  */
+  class QualExprSlidingWindow
+  {
+  public:
+    enum { SLOTS = 10 };					//!< Number of slots per period.
+
+  public:
+    /* Constructor */ QualExprSlidingWindow(qualexpr_time_t period) : m_width(period / SLOTS > 0 ? period / SLOTS : 1) { reset(); }
+
+    void		record(qualexpr_time_t timestamp, long long value);	//!< Record a value at a given time.
+    void		reset(void);						//!< Forget all values.
+    void		merge(const QualExprSlidingWindow &replica);		//!< Add the values of another window of the same period.
+    long long		sum(void) const;					//!< Sum of the values of the window.
+    long long		count(void) const;					//!< Number of values of the window.
+
+  private:
+    typedef struct slot_t {
+      qualexpr_time_t		m_slice;		//!< Index of the time slice held.
+      long long			m_sum;			//!< Sum of the values of the slice.
+      long long			m_count;		//!< Number of values of the slice.
+    } slot_t;
+
+    bool		current(const slot_t &slot) const	{ return slot.m_count && slot.m_slice + SLOTS > m_last; }	//!< Slot in the window.
+
+  private:
+    qualexpr_time_t	m_width;			//!< Duration of a slot.
+    qualexpr_time_t	m_last;				//!< Most recent time slice.
+    slot_t		m_slots[SLOTS];			//!< Time slices, indexed by slice modulo SLOTS.
+  };
+
+  /**
+     @class QualExprDecayedAverage
+     @brief Exponentially weighted moving average over time.
+     @ingroup QualityExpressionEvaluation
+
+     Each value is weighted by exp(-age / period), the age being taken relatively to the most recent
+     event. The weighted sum and the sum of weights are kept at the time of the most recent event, so
+     replicas are merged exactly by aging the oldest one to the time of the other.
+  */
+  class QualExprDecayedAverage
+  {
+  public:
+    /* Constructor */ QualExprDecayedAverage(qualexpr_time_t period) : m_period(period > 0 ? period : 1) { reset(); }
+
+    void		record(qualexpr_time_t timestamp, long long value);	//!< Record a value at a given time.
+    void		reset(void)				{ m_last = 0; m_sum = 0; m_weight = 0; }	//!< Forget all values.
+    void		merge(const QualExprDecayedAverage &replica);		//!< Combine with another average of the same period.
+    long long		average(void) const			{ return m_weight > 0 ? (long long) (m_sum / m_weight + 0.5) : 0; }	//!< Current average.
+
+  private:
+    double		decay(qualexpr_time_t age) const;	//!< Weight of a value of a given age.
+
+  private:
+    qualexpr_time_t	m_period;			//!< Time constant of the decay.
+    qualexpr_time_t	m_last;				//!< Time stamp of the most recent value.
+    double		m_sum;				//!< Weighted sum of the values at m_last.
+    double		m_weight;			//!< Sum of the weights at m_last.
+  };
+
+}
+
+#endif
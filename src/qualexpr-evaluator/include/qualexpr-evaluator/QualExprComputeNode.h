@@ -20,6 +20,13 @@
 #ifndef QUALEXP_COMPUTE_NODE_H_
 #define QUALEXP_COMPUTE_NODE_H_
 
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "quality-expressions/QualityExpressionsOperators.h"
+#include "quality-expressions/QualityExpressionsStatic.h"
+
 namespace quality_expressions_core
 {
   /* ---------------------------------------------------------------------------------------------------------------- */
@@ -27,6 +34,49 @@ namespace quality_expressions_core
   /* ---------------------------------------------------------------------------------------------------------------- */
   /* ---------------------------------------------------------------------------------------------------------------- */
 
+  /** @brief Apply a binary operator given by its opcode. */
+  template<typename kind>
+  inline kind computeOperation(compute_opcode_t op, kind a, kind b)
+  {
+    switch (op) {
+    case OP_LIST:	return list<kind>::compute(a, b);
+    case OP_LT:		return lt<kind>::compute(a, b);
+    case OP_GT:		return gt<kind>::compute(a, b);
+    case OP_LE:		return le<kind>::compute(a, b);
+    case OP_GE:		return ge<kind>::compute(a, b);
+    case OP_ADD:	return add<kind>::compute(a, b);
+    case OP_SUB:	return sub<kind>::compute(a, b);
+    case OP_MUL:	return mul<kind>::compute(a, b);
+    case OP_DIV:	return divi<kind>::compute(a, b);
+    default:		return 0;
+    }
+  }
+
+  /** @brief Display a binary operator given by its opcode. */
+  template<typename kind>
+  inline void displayOperation(compute_opcode_t op, const std::string &indent, std::stringstream &s)
+  {
+    switch (op) {
+    case OP_LIST:	list<kind>::display(indent, s); break;
+    case OP_LT:		lt<kind>::display(indent, s); break;
+    case OP_GT:		gt<kind>::display(indent, s); break;
+    case OP_LE:		le<kind>::display(indent, s); break;
+    case OP_GE:		ge<kind>::display(indent, s); break;
+    case OP_ADD:	add<kind>::display(indent, s); break;
+    case OP_SUB:	sub<kind>::display(indent, s); break;
+    case OP_MUL:	mul<kind>::display(indent, s); break;
+    case OP_DIV:	divi<kind>::display(indent, s); break;
+    default:		break;
+    }
+  }
+
+  template<typename kind> class QualExprComputeProgram;
+
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+  /* ---------------------------------------------------------------------------------------------------------------- */
+
   /**
      @class QualExprComputeNode
      @brief Pure interface for on the fly quality expression compute nodes
@@ -56,6 +106,7 @@ namespace quality_expressions_core
     virtual void   	display(const std::string &indent, std::stringstream &s) const { s << "<abstract node>"; }
     virtual kind	eval(void) = 0;
     virtual void        reset(void) {}
+    virtual size_t	lower(QualExprComputeProgram<kind> &program) const = 0;	//!< Append the node instructions to a program, return the result slot.
 
   protected:
     /* Constructor */ QualExprComputeNodeOf(void) {}
@@ -75,6 +126,7 @@ namespace quality_expressions_core
   public: // -- Access API
     virtual void   	display(const std::string &indent, std::stringstream &s) const { s << std::setprecision(24) << m_value; }
     virtual kind	eval(void)  { return m_value; }
+    virtual size_t	lower(QualExprComputeProgram<kind> &program) const	{ return program.pushImmediate(m_value); }
   private:
     kind		m_value;
   };
@@ -94,6 +146,7 @@ namespace quality_expressions_core
     virtual void   	display(const std::string &indent, std::stringstream &s) const	{ m_semanticAggregator.display(indent, s); }
     virtual kind	eval(void)  { return m_semanticAggregator.evaluate<kind>(); }
     virtual void        reset(void) { m_semanticAggregator.reset(); }
+    virtual size_t	lower(QualExprComputeProgram<kind> &program) const	{ return program.pushAggregator(m_semanticAggregator); }
 
   private:
     QualExprSemanticAggregator &	m_semanticAggregator;			//!< Semantic aggregators.
@@ -113,12 +166,384 @@ namespace quality_expressions_core
   public: // -- Access API
     virtual void   	display(const std::string &indent, std::stringstream &s) const { m_lhs.display(indent, s); arithmetic::display(indent, s); m_rhs.display(indent, s); }
     virtual kind	eval(void)  { return arithmetic::compute(m_lhs.eval(),m_rhs.eval()); }
+    virtual size_t	lower(QualExprComputeProgram<kind> &program) const {
+      size_t lhs = m_lhs.lower(program);
+      size_t rhs = m_rhs.lower(program);
+      return program.pushOperation((compute_opcode_t) arithmetic::opcode, lhs, rhs);
+    }
 
   private:
     QualExprComputeNodeOf<kind> &		m_lhs;
     QualExprComputeNodeOf<kind> &		m_rhs;
   };
 
+  /**
+     @class QualExprComputeInstruction
+     @brief Instruction of compute programs, operands are slot indexes.
+     @ingroup QualityExpressionEvaluation
+  */
+  template<typename kind>
+  struct QualExprComputeInstruction {
+    compute_opcode_t			m_op;			//!< Operation.
+    size_t				m_lhs;			//!< Slot of the left operand.
+    size_t				m_rhs;			//!< Slot of the right operand.
+    kind				m_value;		//!< Immediate value.
+    QualExprSemanticAggregator *	m_aggregator;		//!< Semantic aggregator.
+
+    bool		isOperation(void) const			{ return m_op != OP_IMMEDIATE && m_op != OP_AGGREGATOR; }
+    bool		isImmediate(kind value) const		{ return m_op == OP_IMMEDIATE && m_value == value; }
+    /** @brief Give a single form to equivalent operations: commutative operands are ordered, > and >= become < and <=. */
+    void		normalize(void) {
+      switch (m_op) {
+      case OP_GT:	m_op = OP_LT; std::swap(m_lhs, m_rhs); break;
+      case OP_GE:	m_op = OP_LE; std::swap(m_lhs, m_rhs); break;
+      case OP_ADD:
+      case OP_MUL:	if (m_lhs > m_rhs) std::swap(m_lhs, m_rhs); break;
+      default:		break;
+      }
+    }
+    /** @brief Compute the instruction result from the values of its operands. */
+    kind		execute(kind lhs, kind rhs) const {
+      switch (m_op) {
+      case OP_IMMEDIATE:	return m_value;
+      case OP_AGGREGATOR:	return m_aggregator->template evaluate<kind>();
+      default:			return computeOperation<kind>(m_op, lhs, rhs);
+      }
+    }
+    /** @brief Strict order, used to find identical instructions. */
+    bool		operator<(const QualExprComputeInstruction<kind> &i) const {
+      if (m_op != i.m_op) return m_op < i.m_op;
+      if (m_lhs != i.m_lhs) return m_lhs < i.m_lhs;
+      if (m_rhs != i.m_rhs) return m_rhs < i.m_rhs;
+      if (m_value != i.m_value) return m_value < i.m_value;
+      return m_aggregator < i.m_aggregator;
+    }
+  };
+
+  /**
+     @class QualExprComputeProgram
+     @brief Compute node evaluating a flat program lowered from a compute tree.
+     @ingroup QualityExpressionEvaluation
+
+     Instructions are stored in evaluation order, each one writes the slot of the same index and reads
+     the slots of its operands. The last instruction holds the result.
+  */
+  template<typename kind>
+  class QualExprComputeProgram : public QualExprComputeNodeOf<kind>
+  {
+  public:
+    typedef QualExprComputeInstruction<kind>	instruction_t;
+
+  public:
+    /* Constructor */		QualExprComputeProgram(void) : m_code(), m_slots() {}
+    /* Destructor */ virtual	~QualExprComputeProgram(void) {}
+
+    /** @brief Lower a compute tree, the tree is not modified. */
+    static QualExprComputeProgram<kind> *	compile(const QualExprComputeNodeOf<kind> &root)	{ QualExprComputeProgram<kind> *program = new QualExprComputeProgram<kind>(); root.lower(*program); return program; }
+
+  public: // -- Building API
+    size_t		pushImmediate(kind value)				{ instruction_t i = { OP_IMMEDIATE, 0, 0, value, NULL }; return push(i); }
+    size_t		pushAggregator(QualExprSemanticAggregator &aggreg)	{ instruction_t i = { OP_AGGREGATOR, 0, 0, 0, &aggreg }; return push(i); }
+    size_t		pushOperation(compute_opcode_t op, size_t lhs, size_t rhs)	{ instruction_t i = { op, lhs, rhs, 0, NULL }; return push(i); }
+    size_t		push(const instruction_t &i)				{ m_code.push_back(i); m_slots.push_back(0); return m_code.size() - 1; }
+    size_t		size(void) const					{ return m_code.size(); }
+    const instruction_t &instruction(size_t slot) const			{ return m_code[slot]; }
+    void		simplify(void);							//!< Fold immediates, remove identities and dead instructions.
+
+  public: // -- Access API
+    virtual void   	display(const std::string &indent, std::stringstream &s) const	{ if (!m_code.empty()) display(m_code.size() - 1, indent, s); }
+    virtual void        reset(void) {
+      for (size_t index = 0; index < m_code.size(); index++) {
+        if (m_code[index].m_op == OP_AGGREGATOR) m_code[index].m_aggregator->reset();
+      }
+    }
+    virtual kind	eval(void) {
+      size_t size = m_code.size();
+      if (!size) return 0;
+      const instruction_t *code = &m_code[0];
+      kind *slots = &m_slots[0];
+      for (size_t index = 0; index < size; index++) slots[index] = code[index].execute(slots[code[index].m_lhs], slots[code[index].m_rhs]);
+      return slots[size - 1];
+    }
+    virtual size_t	lower(QualExprComputeProgram<kind> &program) const {
+      size_t base = program.size();
+      for (size_t index = 0; index < m_code.size(); index++) {
+        instruction_t i = m_code[index];
+        if (i.isOperation()) { i.m_lhs += base; i.m_rhs += base; }
+        program.push(i);
+      }
+      return program.size() - 1;
+    }
+
+    /** @brief Display the expression computed by a slot. */
+    void		display(size_t slot, const std::string &indent, std::stringstream &s) const {
+      const instruction_t &i = m_code[slot];
+      switch (i.m_op) {
+      case OP_IMMEDIATE:	s << std::setprecision(24) << i.m_value; break;
+      case OP_AGGREGATOR:	i.m_aggregator->display(indent, s); break;
+      default:			display(i.m_lhs, indent, s); displayOperation<kind>(i.m_op, indent, s); display(i.m_rhs, indent, s); break;
+      }
+    }
+
+  private:
+    size_t		pushSimplified(instruction_t i);			//!< Append an operation, or return the slot of an equivalent value.
+
+  private:
+    std::vector<instruction_t>		m_code;			//!< Instructions in evaluation order.
+    std::vector<kind>			m_slots;		//!< Instruction results.
+  };
+
+  /** @brief Append an operation whose operands are already simplified.
+      Operations on immediates are folded, identities (x+0, 0+x, x-0, x*1, 1*x, x/1) and the discarded
+      operand of a list return the slot of the remaining operand.
+  */
+  template<typename kind>
+  size_t QualExprComputeProgram<kind>::pushSimplified(instruction_t i)
+  {
+    const instruction_t &lhs = m_code[i.m_lhs];
+    const instruction_t &rhs = m_code[i.m_rhs];
+    if (lhs.m_op == OP_IMMEDIATE && rhs.m_op == OP_IMMEDIATE) return pushImmediate(computeOperation<kind>(i.m_op, lhs.m_value, rhs.m_value));
+    switch (i.m_op) {
+    case OP_LIST:	return i.m_lhs;
+    case OP_ADD:	if (rhs.isImmediate(0)) return i.m_lhs; if (lhs.isImmediate(0)) return i.m_rhs; break;
+    case OP_SUB:	if (rhs.isImmediate(0)) return i.m_lhs; break;
+    case OP_MUL:	if (rhs.isImmediate(1)) return i.m_lhs; if (lhs.isImmediate(1)) return i.m_rhs; break;
+    case OP_DIV:	if (rhs.isImmediate(1)) return i.m_lhs; break;
+    default:		break;
+    }
+    i.normalize();
+    return push(i);
+  }
+
+  /** @brief Simplify the program.
+      Instructions are first rewritten in evaluation order, then only the instructions needed by the
+      result are kept. The result is still the last instruction: all kept instructions are its operands.
+  */
+  template<typename kind>
+  void QualExprComputeProgram<kind>::simplify(void)
+  {
+    if (m_code.empty()) return;
+    QualExprComputeProgram<kind> folded;
+    std::vector<size_t> slots(m_code.size());
+    for (size_t index = 0; index < m_code.size(); index++) {
+      instruction_t i = m_code[index];
+      if (i.isOperation()) { i.m_lhs = slots[i.m_lhs]; i.m_rhs = slots[i.m_rhs]; slots[index] = folded.pushSimplified(i); }
+      else slots[index] = folded.push(i);
+    }
+
+    std::vector<bool> live(folded.size(), false);
+    live[slots.back()] = true;
+    for (size_t index = folded.size(); index-- > 0; ) {
+      const instruction_t &i = folded.m_code[index];
+      if (live[index] && i.isOperation()) live[i.m_lhs] = live[i.m_rhs] = true;
+    }
+
+    std::vector<size_t> kept(folded.size());
+    m_code.clear();
+    m_slots.clear();
+    for (size_t index = 0; index < folded.size(); index++) {
+      if (!live[index]) continue;
+      instruction_t i = folded.m_code[index];
+      if (i.isOperation()) { i.m_lhs = kept[i.m_lhs]; i.m_rhs = kept[i.m_rhs]; }
+      kept[index] = push(i);
+    }
+  }
+
+  /**
+     @class QualExprComputeNodeStatic
+     @brief Compute node of a quality expression compiled from a C++ type.
+     @ingroup QualityExpressionEvaluation
+     @sa qe::expr
+  */
+  class QualExprComputeNodeStatic : public QualExprComputeNodeOf<qe::value_t>
+  {
+  public:
+    /* Constructor */		QualExprComputeNodeStatic(qe::expression *expression) : m_expression(expression) {}
+    /* Destructor */ virtual	~QualExprComputeNodeStatic(void)					{ delete m_expression; }
+
+  public: // -- Access API
+    virtual void   	display(const std::string &indent, std::stringstream &s) const		{ m_expression->display(s); }
+    virtual qe::value_t	eval(void)								{ return m_expression->eval(); }
+    virtual void        reset(void)								{ m_expression->reset(); }
+    virtual size_t	lower(QualExprComputeProgram<qe::value_t> &program) const		{ ProgramBuilder builder(program); return m_expression->lower(builder); }
+
+  private:
+    /** @brief Append the instructions of a compiled expression to a program. */
+    class ProgramBuilder : public qe::builder {
+    public:
+      /* Constructor */	ProgramBuilder(QualExprComputeProgram<qe::value_t> &program) : m_program(program) {}
+      virtual size_t	pushImmediate(qe::value_t value)				{ return m_program.pushImmediate(value); }
+      virtual size_t	pushAggregator(qe::aggregator_t &aggreg)			{ return m_program.pushAggregator(aggreg); }
+      virtual size_t	pushOperation(int opcode, size_t lhs, size_t rhs)		{ return m_program.pushOperation((compute_opcode_t) opcode, lhs, rhs); }
+    private:
+      QualExprComputeProgram<qe::value_t> &	m_program;
+    };
+
+  private:
+    qe::expression *		m_expression;			//!< Compiled expression, owned by the node.
+  };
+
+  template<typename kind> class QualExprComputeDAGNode;
+
+  /**
+     @class QualExprComputeDAG
+     @brief Instructions of all the expressions of an evaluator, identical subexpressions are stored once.
+     @ingroup QualityExpressionEvaluation
+
+     Each slot caches its last result with a change stamp taken from a clock increased on each change.
+     A slot is only recomputed when its input changed since the last computation: the aggregator version
+     for aggregator leaves, the most recent stamp of the operands for operations. A recomputed slot
+     keeping the same value keeps its stamp, so unchanged results do not propagate. The slots and the
+     clock are shared by all the expressions of the evaluator, concurrent evaluations are serialized by the DAG lock.
+  */
+  template<typename kind>
+  class QualExprComputeDAG
+  {
+  public:
+    typedef QualExprComputeInstruction<kind>	instruction_t;
+
+  public:
+    /* Constructor */ QualExprComputeDAG(void) : m_code(), m_slots(), m_clock(0), m_index(), m_lock() {}
+    /* Destructor */ ~QualExprComputeDAG(void) {}
+
+    QualExprComputeDAGNode<kind> *	share(const QualExprComputeProgram<kind> &program);	//!< Intern the instructions of a program, return its root node.
+    void				clear(void)			{ m_lock.lock(); m_code.clear(); m_slots.clear(); m_index.clear(); m_lock.unlock(); }
+    size_t				size(void) const		{ return m_code.size(); }	//!< Number of distinct instructions.
+
+    /** @brief Recompute the slots of a schedule whose input changed, return the last one. */
+    kind				evaluate(const std::vector<size_t> &schedule) {
+      m_lock.lock();
+      const instruction_t *code = &m_code[0];
+      slot_t *slots = &m_slots[0];
+      size_t slot = 0;
+      for (size_t index = 0; index < schedule.size(); index++) {
+        slot = schedule[index];
+        const instruction_t &i = code[slot];
+        slot_t &s = slots[slot];
+        unsigned long input;
+        switch (i.m_op) {
+        case OP_IMMEDIATE:	input = 0; break;
+        case OP_AGGREGATOR:	input = i.m_aggregator->version(); break;
+        default:		input = std::max(slots[i.m_lhs].m_stamp, slots[i.m_rhs].m_stamp); break;
+        }
+        if (s.m_stamp && s.m_input == input) continue;
+        kind value = i.execute(slots[i.m_lhs].m_value, slots[i.m_rhs].m_value);
+        if (!s.m_stamp || value != s.m_value) s.m_stamp = ++m_clock;
+        s.m_value = value;
+        s.m_input = input;
+      }
+      kind result = slots[slot].m_value;
+      m_lock.unlock();
+      return result;
+    }
+    const instruction_t &		instruction(size_t slot) const	{ return m_code[slot]; }
+
+  private:
+    typedef std::map<instruction_t, size_t>	InstructionIndex_t;	//!< Storage type choosen to find identical instructions.
+
+    size_t				intern(const instruction_t &i);
+
+    /** @brief Cached instruction result. */
+    typedef struct slot_t {
+      kind				m_value;		//!< Last result.
+      unsigned long			m_stamp;		//!< Clock of the last change of the result, 0 if never computed.
+      unsigned long			m_input;		//!< Input of the last computation.
+    } slot_t;
+
+  private:
+    std::vector<instruction_t>		m_code;			//!< Distinct instructions, operands are always stored before.
+    std::vector<slot_t>			m_slots;		//!< Instruction results.
+    unsigned long			m_clock;		//!< Change clock.
+    InstructionIndex_t			m_index;		//!< Slot of each distinct instruction.
+    QualExprSemaphore			m_lock;			//!< Serializes the evaluations and the updates of the instructions.
+  };
+
+  /**
+     @class QualExprComputeDAGNode
+     @brief Compute node of an expression stored in a shared instruction DAG.
+     @ingroup QualityExpressionEvaluation
+
+     The schedule lists the slots needed by the expression in evaluation order, the last one holds the result.
+  */
+  template<typename kind>
+  class QualExprComputeDAGNode : public QualExprComputeNodeOf<kind>
+  {
+  public:
+    /* Constructor */		QualExprComputeDAGNode(QualExprComputeDAG<kind> &dag) : m_dag(dag), m_schedule() {}
+    /* Destructor */ virtual	~QualExprComputeDAGNode(void) {}
+
+  public: // -- Access API
+    virtual void   	display(const std::string &indent, std::stringstream &s) const	{ if (!m_schedule.empty()) display(m_schedule.back(), indent, s); }
+    virtual kind	eval(void)							{ return m_schedule.empty() ? 0 : m_dag.evaluate(m_schedule); }
+    virtual void        reset(void) {
+      for (size_t index = 0; index < m_schedule.size(); index++) {
+        const QualExprComputeInstruction<kind> &i = m_dag.instruction(m_schedule[index]);
+        if (i.m_op == OP_AGGREGATOR) i.m_aggregator->reset();
+      }
+    }
+    virtual size_t	lower(QualExprComputeProgram<kind> &program) const {
+      std::map<size_t, size_t> slots;
+      for (size_t index = 0; index < m_schedule.size(); index++) {
+        QualExprComputeInstruction<kind> i = m_dag.instruction(m_schedule[index]);
+        if (i.isOperation()) { i.m_lhs = slots[i.m_lhs]; i.m_rhs = slots[i.m_rhs]; }
+        slots[m_schedule[index]] = program.push(i);
+      }
+      return program.size() - 1;
+    }
+
+  private:
+    friend class QualExprComputeDAG<kind>;
+
+    void		display(size_t slot, const std::string &indent, std::stringstream &s) const {
+      const QualExprComputeInstruction<kind> &i = m_dag.instruction(slot);
+      switch (i.m_op) {
+      case OP_IMMEDIATE:	s << std::setprecision(24) << i.m_value; break;
+      case OP_AGGREGATOR:	i.m_aggregator->display(indent, s); break;
+      default:			display(i.m_lhs, indent, s); displayOperation<kind>(i.m_op, indent, s); display(i.m_rhs, indent, s); break;
+      }
+    }
+
+  private:
+    QualExprComputeDAG<kind> &		m_dag;			//!< Shared instructions.
+    std::vector<size_t>			m_schedule;		//!< Slots of the expression in evaluation order.
+  };
+
+  /** @brief Return the slot of an instruction, appended if no identical instruction exists. */
+  template<typename kind>
+  size_t QualExprComputeDAG<kind>::intern(const instruction_t &i)
+  {
+    typename InstructionIndex_t::const_iterator ite = m_index.find(i);
+    if (ite != m_index.end()) return ite->second;
+    slot_t slot = { 0, 0, 0 };
+    m_code.push_back(i);
+    m_slots.push_back(slot);
+    m_index[i] = m_code.size() - 1;
+    return m_code.size() - 1;
+  }
+
+  /** @brief Intern the instructions of a program.
+      The program is not modified, the returned node shares the identical subexpressions of other programs.
+  */
+  template<typename kind>
+  QualExprComputeDAGNode<kind> * QualExprComputeDAG<kind>::share(const QualExprComputeProgram<kind> &program)
+  {
+    QualExprComputeDAGNode<kind> *node = new QualExprComputeDAGNode<kind>(*this);
+    std::vector<size_t> slots(program.size());
+    std::vector<bool> scheduled;
+    m_lock.lock();
+    for (size_t index = 0; index < program.size(); index++) {
+      instruction_t i = program.instruction(index);
+      if (i.isOperation()) { i.m_lhs = slots[i.m_lhs]; i.m_rhs = slots[i.m_rhs]; i.normalize(); }
+      slots[index] = intern(i);
+      scheduled.resize(m_code.size(), false);
+      if (!scheduled[slots[index]] || index + 1 == program.size()) {
+        scheduled[slots[index]] = true;
+        node->m_schedule.push_back(slots[index]);
+      }
+    }
+    m_lock.unlock();
+    return node;
+  }
 }
 
 #endif
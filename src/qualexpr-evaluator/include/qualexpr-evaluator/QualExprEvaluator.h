@@ -24,6 +24,8 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <vector>
+#include <map>
 
 /**
  * @defgroup QualityExpressionEvaluation Quality expressions evaluation
@@ -45,6 +47,7 @@
 #include "qualexpr-evaluator/QualExprAggregatorTime.h"
 #include "qualexpr-evaluator/QualExprAggregatorSize.h"
 #include "qualexpr-evaluator/QualExprAggregatorBandwidth.h"
+#include "qualexpr-evaluator/QualExprAggregatorFrequency.h"
 
 namespace quality_expressions_core {
   typedef quality_expressions_ns::QualExprSemantic QualExprSemantic;
@@ -70,6 +73,29 @@ namespace quality_expressions_core
   class QualExprEvaluator;
   typedef unsigned long Context_t;	//!< Define an evaluation context.
 
+  /**
+     @class QualExprComputePlan
+     @brief Parsed quality expression independent of any evaluation context.
+     @ingroup QualityExpressionEvaluation
+
+     A plan holds the instructions of a compute program with the event and aggregator names of its
+     aggregators, a context instantiates it by binding these names to its own aggregators.
+  */
+  class QualExprComputePlan
+  {
+  public:
+    /* Constructor */ QualExprComputePlan(const QualExprComputeProgram<long64_t> &program);
+    /* Destructor */ ~QualExprComputePlan(void) {}
+
+    QualExprComputeProgram<long64_t> *	instantiate(QualExprEvaluator &context) const;	//!< Build the program of a context, throw QualExprEvaluator::Exception.
+
+  private:
+    typedef std::pair<std::string, std::string>		AggregatorName_t;		//!< Event and aggregator names.
+
+    std::vector<QualExprComputeInstruction<long64_t> >	m_code;				//!< Instructions, without aggregators.
+    std::vector<AggregatorName_t>			m_aggregators;			//!< Aggregator names of the instructions.
+  };
+
   /**
      @class QualExprEvaluatorFrame
      @brief Global quality expression Evaluation framework.
@@ -109,9 +135,12 @@ namespace quality_expressions_core
     { lock(); m_semanticRootNamespace.registerNewNamespace(ns); unlock(); }
 
   private:
+    typedef std::map<std::string, QualExprComputePlan *>	PlanCache_t;		//!< Storage type choosen for the plans by mangled expression.
+
     QualExprSemanticNamespaceStem	m_semanticRootNamespace;		//!< Container for the root namespace of semantics.
     QualExprAggregatorNamespace		m_aggregatorRootNamespace;		//!< Container for the root namespace of aggregators.
     QualExprEvaluatorParsingDriver &	m_parser;				//!< Quality expression Parser and arithmetic builder.
+    PlanCache_t				m_planCache;				//!< Plans of the expressions already parsed.
   };
 
   /**
@@ -120,15 +149,20 @@ namespace quality_expressions_core
      @ingroup QualityExpressionEvaluation
 
      This class is be used to store and manage all evaluation contexts.
+     Evaluators are looked up first in a thread local cache, then in a hashed directory under lock.
+     Evaluators are only deleted by clearEvaluators(), which renews the cache key of the stack.
+     Events carrying a context are only evaluated by the evaluator of this context and by global evaluators,
+     events without context are broadcast to all evaluators.
   */
   class QualExprEvaluatorStack : private QualExprSemaphore
   {
   public:
-    /* Constructor */ QualExprEvaluatorStack(void) : m_contextDB()		{}
-    /* Destructor */ ~QualExprEvaluatorStack(void)				{ clearEvaluators(); }
+    /* Constructor */ QualExprEvaluatorStack(void);
+    /* Destructor */ ~QualExprEvaluatorStack(void);
 
   public: // -- Evaluator DB API
     QualExprEvaluator &			getEvaluator(QualExprEvaluatorFrame &frame, Context_t context);
+    QualExprEvaluator &			addGlobalEvaluator(QualExprEvaluatorFrame &frame, Context_t context);	//!< Return the evaluator of a context receiving all events.
     void				clearEvaluators(void);
 
     // -- Operations made on all the DB
@@ -136,10 +170,32 @@ namespace quality_expressions_core
     void				resetMeasures(void);								//!< Reset to the neutral value all aggregators.
     void			   	consolidate(void) throw();							//!< If possible improve data structures to speed-up event evaluations.
     void				evaluateEvent(const QualExprEvent &eventSem) throw();				//!< Dispatch an event.
+    void				evaluateEvents(const QualExprEvent *eventSem, size_t count) throw();		//!< Dispatch a batch of events.
+
+  private:
+    /** @brief Hashed directory entry. */
+    typedef struct ContextEntry_t {
+      Context_t				m_context;		//!< Evaluation context.
+      QualExprEvaluator *		m_evaluator;		//!< Evaluator of the context.
+      struct ContextEntry_t *		m_next;			//!< Next entry in the bucket.
+    } ContextEntry_t;
+
+    typedef QualExprThreadCache<QualExprEvaluatorStack>	EvaluatorCache_t;	//!< Thread local cache of evaluators, indexed by context.
+    typedef std::vector<QualExprEvaluator *>		EvaluatorList_t;	//!< Storage type choosen for the operations on all evaluators.
+
+    size_t				bucket(Context_t context) const			{ return ((context * 0x9E3779B1UL) ^ (context >> 16)) & (m_contextBuckets - 1); }
+    QualExprEvaluator *			findEvaluator(Context_t context) const;		//!< Slow path lookup, the stack must be locked.
+    QualExprEvaluator *			routeEvaluator(Context_t context) const;	//!< Lookup for event routing, NULL if the context has no evaluator.
+    bool				isGlobal(const QualExprEvaluator *evaluator) const;
+    void				routeEvents(const QualExprEvent *eventSem, size_t count) throw();	//!< Dispatch a batch of events sharing one context.
+    void				growDirectory(void);				//!< Double the number of buckets, the stack must be locked.
 
   private:
-    typedef std::map<Context_t, QualExprEvaluator *>	ContextNodeDB_t;	//!< Storage type choosen for the evaluation contexts.
-    ContextNodeDB_t					m_contextDB;		//!< Evaluation context database.
+    ContextEntry_t **			m_contextDB;		//!< Evaluation context directory, hashed by context.
+    size_t				m_contextBuckets;	//!< Number of buckets of the directory, a power of 2.
+    EvaluatorList_t			m_evaluatorList;	//!< All evaluators, for broadcast operations.
+    EvaluatorList_t			m_globalList;		//!< Evaluators receiving the events of all contexts.
+    unsigned long			m_cacheKey;		//!< Thread cache owner key, renewed when evaluators are deleted.
   };
 
   /**
@@ -178,15 +234,20 @@ namespace quality_expressions_core
 
   public: // -- Evaluation API
     size_t 	pushMeasure(const QualityExpressionEntry &qualExprEntry) throw(Exception);	//!< Parse and build a quality expression.
+    size_t 	pushStaticMeasure(QualityExpressionID_T id, qe::expression *expression) throw(Exception);	//!< Bind and register a compiled quality expression.
     void   	consolidate(void) throw();							//!< If possible improve data structures to speed-up event evaluations.
     void   	evaluateEvent(const QualExprEvent &) throw();					//!< Update quality expressions with event properties.
+    void   	evaluateEvents(const QualExprEvent *, size_t) throw();				//!< Update quality expressions with a batch of events.
 
     long64_t	getLongCounter(QualityExpressionID_T id) throw(Exception);			//!< Return the current value of a quality expression by its ID.
+    size_t	getLongCounters(const QualityExpressionID_T *ids, long64_t *values, size_t count) throw();	//!< Return the current values of quality expressions by their IDs.
+    size_t	getAllLongCounters(QualityExpressionID_T *ids, long64_t *values, size_t count) throw();	//!< Return the IDs and current values of all quality expressions.
     void        removeExpression(QualityExpressionID_T id) throw(Exception);                    //!< Remove a quality expression by its ID.
     void        resetExpression(QualityExpressionID_T id) throw(Exception);                     //!< Reset the value of a quality expression by its ID.
 
   public: // -- Parsing API
     QualExprComputeNodeOf<long64_t> *	pushAggregator(const std::string &eventName, const std::string aggregName) throw(Exception);		//!< Add a semantic aggregator. @return the aggregator ID.
+    QualExprSemanticAggregator &	pushSemanticAggregator(const std::string &eventName, const std::string aggregName) throw(Exception);	//!< Add a semantic aggregator computing long64_t values.
     void				pushRootComputeNode(QualityExpressionID_T entryID, QualExprComputeNode *computeNode) throw(Exception);	//!< Add a compute node.
 
   public: // -- Namespace management API
@@ -194,11 +255,20 @@ namespace quality_expressions_core
     // { m_evaluationFrame.registerSemanticNamespace(ns); }
 
   private:
-    typedef std::map<QualityExpressionID_T, QualExprComputeNode *>	ComputeNodeDB_t;        //!< Storage type choosen for the compute nodes.
+    /** @brief Compute node of a quality expression, with its type resolved once at registration. */
+    typedef struct ComputeEntry_t {
+      QualExprComputeNode *		m_node;		//!< Compute node, owned by the evaluator.
+      QualExprComputeNodeOf<long64_t> *	m_longNode;	//!< The same node computing long64_t values, NULL for another type.
+    } ComputeEntry_t;
+    typedef std::map<QualityExpressionID_T, ComputeEntry_t>	ComputeNodeDB_t;        //!< Storage type choosen for the compute nodes.
+
+    QualExprComputeNode *		share(QualExprComputeNode *computeNode);	//!< Move the instructions of a compute program in the compute DAG.
+    void				registerNode(QualityExpressionID_T entryID, QualExprComputeNode *computeNode);	//!< Record a compute node with its type.
 
     QualExprEvaluatorFrame &		m_evaluationFrame;			//!< Evaluation framework.
     QualExprSemanticAggregatorDB &	m_semanticAggregatorDB;                 //!< Database containing all semantic aggregators.
     ComputeNodeDB_t			m_computeNodeDB;                        //!< Database containing all compute nodes by ID.
+    QualExprComputeDAG<long64_t>	m_computeDAG;				//!< Instructions shared by all compute nodes.
   };
 
 }
@@ -58,6 +58,7 @@ namespace quality_expressions_core
 
     void				setResult(QualExprComputeNode *node)		{ m_resultNode = node; }
     QualExprComputeNode *		result(void)					{ return m_resultNode; }
+    void				lowerResult(void);							//!< Lower the parsed compute tree into a flat program.
 
   private: // Members //
     QualExprEvaluator *			m_currentContext;		//!< Parsing context. Used to update the database containing all semantic aggregators.
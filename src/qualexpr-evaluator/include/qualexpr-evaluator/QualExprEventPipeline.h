@@ -0,0 +1,146 @@
+/**
+   @file    QualExprEventPipeline.h
+   @ingroup QualityExpressionCore
+   @brief   Quality Expression asynchronous event pipeline headers
+   @author  Laurent Morin
+   @verbatim
+   Revision:       $Revision$
+   Revision date:  $Date$
+   Committed by:   $Author$
+
+   This file is part of the Periscope performance measurement tool.
+   See http://www.lrr.in.tum.de/periscope for details.
+
+   Copyright (c) 2005-2014, Technische Universitaet Muenchen, Germany
+   See the COPYING file in the base directory of the package for details.
+
+   @endverbatim
+*/
+
+#ifndef QUALEXPREVENTPIPELINE_H_
+#define QUALEXPREVENTPIPELINE_H_
+
+#include "quality-expressions/QualityExpressionsProfilerSystem.h"
+#include "qualexpr-evaluator/QualExprEvaluator.h"
+#include "qualexpr-profiler/QualExprProfiler.h"
+
+namespace quality_expressions_core
+{
+  /** @def   QUALEXPR_ASYNC_RING_ENVNAME
+      @ingroup QualityExpressionCore
+      @brief Number of events of the per-thread ring buffers, asynchronous aggregation is disabled if not set or 0.
+  */
+#define QUALEXPR_ASYNC_RING_ENVNAME "QUALITY_EXPRESSION_ASYNC_RING"
+
+  /** @def   QUALEXPR_ASYNC_OVERFLOW_ENVNAME
+      @ingroup QualityExpressionCore
+      @brief Overflow policy of the ring buffers: "block" (default) or "drop".
+  */
+#define QUALEXPR_ASYNC_OVERFLOW_ENVNAME "QUALITY_EXPRESSION_ASYNC_OVERFLOW"
+
+  /**
+     @class QualExprEventRing
+     @brief Single producer, single consumer ring buffer of time stamped events.
+     @ingroup QualityExpressionCore
+
+     Events are stored as records with their time stamp and context, so a contiguous part of the ring
+     can be handed over as a batch to the event builder.
+  */
+  class QualExprEventRing
+  {
+  public:
+    /* Constructor */ QualExprEventRing(size_t size, pthread_t owner);
+    /* Destructor */ ~QualExprEventRing(void);
+
+  public: // -- Producer API
+    bool			push(const profiling_event_t &event, qualexpr_time_t timestamp, unsigned long context);	//!< Append an event, false if the ring is full.
+
+    bool			valid(void) const						{ return m_records != NULL; }		//!< False if the storage could not be allocated.
+
+  public: // -- Consumer API
+    size_t			front(QualExprEventRecord **records) const;			//!< Return the contiguous events available, without removing them.
+    void			pop(size_t count)						{ __sync_synchronize(); m_head += count; }	//!< Release processed events.
+    size_t			tail(void) const						{ return m_tail; }			//!< Producer position.
+    size_t			head(void) const						{ return m_head; }			//!< Consumer position.
+    const QualExprEventRecord &	record(size_t position) const					{ return m_records[position & m_mask]; }	//!< Event at a position.
+
+  public:
+    pthread_t			m_owner;			//!< Producer thread.
+    QualExprEventRing *		m_next;				//!< Next ring of the pipeline.
+
+  private:
+    size_t			m_mask;				//!< Ring size minus one, the size is a power of 2.
+    QualExprEventRecord *	m_records;			//!< Event storage.
+    volatile size_t		m_head;				//!< Consumer position, only written by the consumer.
+    volatile size_t		m_tail;				//!< Producer position, only written by the producer.
+  };
+
+  /**
+     @class QualExprEventPipeline
+     @brief Asynchronous aggregation of events.
+     @ingroup QualityExpressionCore
+
+     Producer threads only time stamp events and push them in their own ring buffer. The drain thread
+     aggregates the content of all rings in the evaluator stack, it lives as long as the pipeline and
+     is parked on a condition variable while the rings are empty. Events are always aggregated by the
+     drain thread, so the replicas of the evaluators are those of a single thread. Only if the drain
+     thread can not be created are the rings drained by flush() and by the producers of a full ring,
+     serialized by the pipeline lock.
+
+     The rings are merged in time stamp order, so a region started and stopped by different threads is
+     paired whatever the order of the rings.
+  */
+  class QualExprEventPipeline : private QualExprSemaphore
+  {
+  public:
+    enum overflow_policy_t	{ O_BLOCK = 0, O_DROP };		//!< Behavior of producers on a full ring.
+
+  public:
+    /* Constructor */ QualExprEventPipeline(QualExprEvaluatorStack &stack, QualExprEventBuilder &builder, size_t ringSize, overflow_policy_t policy);
+    /* Destructor */ ~QualExprEventPipeline(void);
+
+    static QualExprEventPipeline *	buildFromEnvironment(QualExprEvaluatorStack &stack, QualExprEventBuilder &builder);	//!< Build a pipeline if requested in the environment, NULL otherwise.
+
+  public: // -- Producer API
+    void			push(const profiling_event_t &event, qualexpr_time_t timestamp, unsigned long context);	//!< Push an event in the ring of the calling thread.
+
+  public: // -- Control API
+    void			flush(void);							//!< Wait until all events pushed are aggregated.
+    size_t			dropped(void) const						{ return m_dropped; }	//!< Number of events dropped on overflow.
+
+  private:
+    QualExprEventRing *		threadRing(void);						//!< Return the ring of the calling thread, NULL if it can not be allocated.
+    size_t			drain(void);							//!< Aggregate available events, return the number of events.
+    bool			pending(void) const;						//!< True if a ring holds events.
+    void			wakeup(void);							//!< Wake up the drain thread if it is parked.
+    static void *		drainThread(void *pipeline);					//!< Drain thread main loop.
+
+  private:
+    typedef QualExprThreadCache<QualExprEventPipeline>	RingCache_t;			//!< Thread local cache of rings.
+    /** @brief Part of a ring aggregated by a drain pass. */
+    typedef struct {
+      QualExprEventRing *	m_ring;				//!< Ring drained.
+      size_t			m_mark;				//!< Events before this position are aggregated whatever their time stamp.
+      size_t			m_limit;			//!< Producer position when the pass started.
+    } RingCursor_t;
+
+    QualExprEvaluatorStack &	m_stack;			//!< Evaluators receiving the events.
+    QualExprEventBuilder &	m_builder;			//!< Event descriptor builder.
+    size_t			m_ringSize;			//!< Number of events per ring.
+    overflow_policy_t		m_policy;			//!< Overflow policy.
+    QualExprEventRing *		m_ringList;			//!< Lock-free list of rings.
+    unsigned long		m_ringKey;			//!< Thread cache owner key.
+    size_t			m_dropped;			//!< Atomic counter of dropped events.
+    volatile bool		m_parked;			//!< Drain thread waiting for events.
+    volatile bool		m_exiting;			//!< Drain thread requested to terminate.
+    bool			m_threaded;			//!< Drain thread created, events are drained by the callers otherwise.
+    pthread_t			m_thread;			//!< Drain thread.
+    pthread_mutex_t		m_parkLock;			//!< Protects the parking of the drain thread and the flush waits.
+    pthread_cond_t		m_wakeup;			//!< Signaled to wake up the parked drain thread.
+    pthread_cond_t		m_drained;			//!< Broadcast by the drain thread after aggregating events.
+    std::vector<RingCursor_t>	m_cursors;			//!< Rings of the current drain pass, protected by the pipeline lock.
+  };
+
+}
+
+#endif
@@ -26,6 +26,7 @@
 #include "quality-expressions/QualityExpressionsProfilerSystem.h"
 #include "qualexpr-evaluator/QualExprEvaluator.h"
 #include "qualexpr-profiler/QualExprProfiler.h"
+#include "qualexpr-evaluator/QualExprEventPipeline.h"
 
 namespace quality_expressions_core
 {
@@ -81,20 +82,27 @@ namespace quality_expressions_core
 
     size_t		addGlobalCounter(const QualityExpressionEntry &entry) throw(Exception);			//!< Append globally a quality expresion evaluation request.
     size_t		addCounter(Context_t contextId, const QualityExpressionEntry &entry) throw(Exception);	//!< Append a quality expresion evaluation request.
+    size_t		addStaticCounter(Context_t contextId, QualityExpressionID_T id, qe::expression *expression) throw(Exception);	//!< Append a compiled quality expresion, owned by the manager.
     long long		getLongCounter(Context_t contextId, QualityExpressionID_T id) throw(Exception);		//!< Retrieve the current quality expresion evaluation value.
+    size_t		getLongCounters(Context_t contextId, const QualityExpressionID_T *ids, long long *values, size_t count) throw(Exception);	//!< Retrieve the current values of several quality expresions.
+    size_t		getAllLongCounters(Context_t contextId, QualityExpressionID_T *ids, long long *values, size_t count) throw(Exception);	//!< Retrieve the IDs and current values of all quality expresions.
     void		resetCounter(Context_t contextId, QualityExpressionID_T id) throw(Exception);		//!< Reset the current quality expresion evaluation value.
     void		removeCounter(Context_t contextId, QualityExpressionID_T id) throw(Exception);		//!< Remove a quality expresion evaluation.
     void		removeCounters(Context_t contextId) throw(Exception);					//!< Remove quality expresions of a given context.
     void		resetCounters(Context_t contextId) throw(Exception);					//!< Reset quality expresions of a given context.
     void		removeAllCounters(void) throw(Exception);						//!< Remove all quality expresion evaluators.
     void		resetAllCounters(void) throw(Exception);						//!< Reset all quality expresions.
+    void		addGlobalContext(Context_t contextId) throw(Exception);					//!< Make a context receive the events of all contexts.
 
     void		enableMeasures(void);								//!< Enable measurements.
     void		disableMeasures(void);								//!< Disable measurements.
 
   public:	// Profiling system API
-    double		timestamp(void) throw()								{ return m_timer.timestamp(); }
+    qualexpr_time_t	timestamp(void) throw()								{ return m_timer->timestamp(); }
     void		event(profiling_event_t * event) throw();					//!< Handle an event for quality expressions.
+    void		events(profiling_event_t * events, size_t count) throw();			//!< Handle a batch of events for quality expressions.
+    void		setActiveContext(Context_t contextId) throw();					//!< Route the events of the calling thread to a context.
+    void		clearActiveContext(void) throw();						//!< Broadcast the events of the calling thread to all contexts.
 
   private:	// Internal functions
     void			evaluateVerbosityLevel(void);							//!< Read the verbosity level from an environment variable.
@@ -112,12 +120,13 @@ namespace quality_expressions_core
   private:	// Data structures 
     enum debug_level_t				m_debugLevel;			//!< Current verbosity level.
     enum profiler_state_t			m_state;			//!< Status of the profiling system.
-    QualExprTimerStdUnix			m_timer;			//!< Global tic-tac.
+    QualExprTimer *				m_timer;			//!< Global tic-tac, selected in the environment.
     QualExprEvaluatorFrame			m_evaluatorFrame;		//!< Quality expression evaluation frame.
     QualExprEvaluatorStack			m_evaluatorStack;		//!< Quality expression evaluators stack.
     // EvaluatorFrameSet_T				m_evaluatorFrames;		//!< Quality expression evaluation frame / thread.
     // EvaluatorSet_T				m_evaluators;			//!< Quality expression evaluators / thread.
     QualExprEventBuilder			m_eventBuilder;			//!< Convert basic events into event descriptors.
+    QualExprEventPipeline *			m_eventPipeline;		//!< Asynchronous aggregation of events, NULL if events are aggregated by producers.
     // std::vector<semantic_namespace_t>		m_semanticNamespaceList;	//!< List of profiler semantic namespaces.
     // std::vector<QualityExpressionEntry*>	m_expressionList;		//!< List of quality expression entries given.
   };
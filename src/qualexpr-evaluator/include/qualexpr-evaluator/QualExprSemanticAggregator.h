@@ -30,42 +30,97 @@ namespace quality_expressions_core
   /**
      @class QualExprSemanticAggregator
      @brief Combines a semantic and an aggregator.
+
+     Events are never aggregated in the prototype aggregator, but in one replica per thread built
+     with QualExprAggregator::replicate(). Replicas are built by their owner thread and updated without
+     atomic operation. When their owner terminates, they are merged in the retired aggregator and freed.
+     The evaluation merges them in a scratch aggregator with the merge rule of the aggregator. The merge is kept
+     while the version - the sum of the replica versions and of the number of resets - is unchanged. The list
+     of replicas, the retired and the scratch aggregators are protected by the scratch lock, the updates of the
+     replicas are not.
+
      @ingroup QualityExpressionEvaluation
   */
   class QualExprSemanticAggregator
   {
   public:
-    /* Constructor */ QualExprSemanticAggregator(const QualExprSemantic & sem, QualExprAggregator & aggregator) : m_sem(sem), m_aggregator(aggregator) {}
-    /* Destructor */ ~QualExprSemanticAggregator(void) { delete &m_sem; delete &m_aggregator; }
+    /* Constructor */ QualExprSemanticAggregator(const QualExprSemantic & sem, QualExprAggregator & aggregator) :
+      m_sem(sem), m_aggregator(aggregator), m_replicaList(NULL), m_replicaKey(ReplicaCache_t::newOwnerKey()), m_retired(NULL), m_retiredVersion(0),
+      m_scratch(NULL), m_scratchVersion(0), m_scratchLock(), m_resets(0) {}
+    /* Destructor */ ~QualExprSemanticAggregator(void);
 
   public: // -- Access API
     const char *	aggregName(void) const						{ return m_aggregator.name(); }
     const char *	semanticName(void) const					{ return m_sem.name(); }
     std::string		name(void) const						{ std::string r = m_sem.name(); r += ':'; r += m_aggregator.name(); return r; }
-    void 		display(const std::string &indent, std::stringstream &s) const	{ s << m_sem.name() << ':'; m_aggregator.display(indent, s); }
+    void 		display(const std::string &indent, std::stringstream &s) const	{ s << m_sem.name() << ':'; m_scratchLock.lock(); mergedAggregator().display(indent, s); m_scratchLock.unlock(); }
     size_t		getId(void) const						{ return m_aggregator.getId(); }
-    void		reset(void)							{ return m_aggregator.reset(); }		//!< Reset to the neutral value all aggregators.
+    QualExprAggregator::lane_t lane(void) const					{ return m_aggregator.lane(); }			//!< Accumulation of the replica lanes.
+    const char *	laneSource(void) const						{ return m_aggregator.laneSource(); }		//!< Source of the values of the replica lanes.
+    void		reset(void);									//!< Reset to the neutral value all aggregators.
+    unsigned long	version(void) const						{ m_scratchLock.lock(); unsigned long v = currentVersion(); m_scratchLock.unlock(); return v; }	//!< Update counter, changed by any event or reset.
 
   public: // -- Semantic aggregation API
     bool		matchSemantic(unsigned int sem)					{ return m_sem.matchSemantic(sem); }		//!< Return if the semantic match the given semantic ID.
-    void 		processEvent(const QualExprEvent &event)			{ m_aggregator.processEvent(event); }		//!< Aggregate the given event.
+    bool		semanticRange(unsigned int &first, unsigned int &last) const	{ return m_sem.semanticRange(first, last); }	//!< Range [first, last[ of the semantic IDs matched, false if unknown.
+    void 		processEvent(const QualExprEvent &event)			{ threadReplica().aggregate(event); }		//!< Aggregate the given event.
+    void		retireReplica(pthread_t owner);							//!< Merge the replica of a terminated thread in the retired aggregator.
+    /** @brief Move the state of a replica in a lane, or back in the replica if lanes is NULL.
+        Done under the scratch lock, so the replica is not read by an evaluation meanwhile.
+    */
+    void		bindReplica(QualExprAggregator &replica, QualExprLanes *lanes, size_t lane)	{ m_scratchLock.lock(); replica.bindLane(lanes, lane); m_scratchLock.unlock(); }
+    /** @brief Return the replica of the calling thread, built on the first call.
+        The replica is found in the thread cache, the list of replicas is only searched on a miss.
+    */
+    QualExprAggregator &threadReplica(void) {
+      QualExprAggregator *replica = (QualExprAggregator *) ReplicaCache_t::find(m_replicaKey, 0);
+      return replica ? *replica : buildReplica();
+    }
 
-    /** @brief Aggregator evaluation method.
-        @remarks kind is the numeric type used for the computation.
-        @param neutralValue
+    /** @brief Return if the aggregator values are of the given type.
+        Checked once when the aggregator is registered in a compute node, evaluate() relies on it.
+    */
+    template <typename kind>
+    bool		evaluates(void) const						{ return dynamic_cast<const QualExprAggregatorEval<kind> *>(&m_aggregator) != NULL; }
 
-        TODO: This aggregator evaluation takes a neutral value in reaplacement of a correct error management.
-        This must be changed, defensive code is never the right answer.
+    /** @brief Aggregator evaluation method.
+        @remarks kind is the numeric type used for the computation, evaluates<kind>() must be true.
+        Replicas and the merge target are built from the prototype, so they share its type.
+        The merge target is only read under the scratch lock, it may be merged again by the next evaluation.
     */
     template <typename kind>
-    kind		evaluate(kind neutralValue = 0) const {
-      QualExprAggregatorEval<kind> *aggregator = dynamic_cast<QualExprAggregatorEval<kind> *>(&m_aggregator);
-      return aggregator ? aggregator->evaluate() : neutralValue;
+    kind		evaluate(void) const {
+      m_scratchLock.lock();
+      kind value = static_cast<const QualExprAggregatorEval<kind> &>(mergedAggregator()).evaluate();
+      m_scratchLock.unlock();
+      return value;
     }
 
+  private:
+    /** @brief Thread replica descriptor, replicas are only pushed on the list head. */
+    typedef struct replica_t {
+      pthread_t			m_owner;				//!< Thread owning the replica.
+      QualExprAggregator *	m_aggregator;				//!< Aggregator updated only by the owner.
+      struct replica_t *	m_next;					//!< Next replica.
+    } replica_t;
+
+    const QualExprAggregator &	mergedAggregator(void) const;				//!< Merge all replicas, the scratch lock must be held.
+    unsigned long		currentVersion(void) const;				//!< Update counter, the scratch lock must be held.
+    QualExprAggregator &	buildReplica(void);					//!< Find or build the replica of the calling thread.
+
+    typedef QualExprThreadCache<QualExprSemanticAggregator, 256>	ReplicaCache_t;	//!< Thread local cache of replicas.
+
   private:
     const QualExprSemantic &	m_sem;							//!< The semantic descriptor.
-    QualExprAggregator &	m_aggregator;						//!< The event aggregator.
+    QualExprAggregator &	m_aggregator;						//!< The aggregator prototype, never updated.
+    replica_t *			m_replicaList;						//!< Lock-free list of thread replicas.
+    unsigned long		m_replicaKey;						//!< Thread cache owner key.
+    QualExprAggregator *	m_retired;						//!< Merge of the replicas of terminated threads, NULL if none.
+    unsigned long		m_retiredVersion;					//!< Sum of the versions of the retired replicas.
+    mutable QualExprAggregator *m_scratch;						//!< Merge target for the evaluation.
+    mutable unsigned long	m_scratchVersion;					//!< Version of the merged replicas.
+    mutable QualExprSemaphore	m_scratchLock;						//!< Serializes the merges and the reads of the scratch aggregator.
+    unsigned long		m_resets;						//!< Number of resets.
   };
 
 }
@@ -26,6 +26,23 @@ namespace quality_expressions_core
   /**
      @class QualExprSemanticAggregatorDB
      @brief Database of all semantic/aggregator combinations.
+
+     Event evaluation is lock free: each thread owns a shard holding its aggregator replicas, in the
+     order of the aggregator cache, and found through a thread local cache. Shards are freed when
+     the aggregator cache is cleaned, while no event can be evaluated, or when their thread terminates:
+     the replicas of the thread are then retired from all semantic aggregators of all databases.
+
+     Events are dispatched through an index built with the aggregator cache: dense blocks of semantic IDs
+     give for each ID the span of the aggregators matching it. Only aggregators whose semantic can not
+     provide its range of IDs are still filtered with matchSemantic().
+
+     The count, value and version of the replicas accumulating by sum, maximum or minimum are stored in the
+     lanes of their shard (see QualExprLanes). For each semantic ID, the dispatch index groups these
+     aggregators by source of values and accumulation in ranges of consecutive lanes. Events are processed
+     in runs of the same semantic ID: a source is sampled once per event, by the replica of its first
+     aggregator, and the samples are accumulated in its lane ranges. Replicas are moved back in their
+     objects before their shard is freed.
+
      @ingroup QualityExpressionEvaluation
   */
   class QualExprSemanticAggregatorDB
@@ -44,10 +61,13 @@ namespace quality_expressions_core
 
   public:
     /* Constructor */ QualExprSemanticAggregatorDB(QualExprSemanticNamespaceStem &semRootNs, QualExprAggregatorNamespace &aggregRootNs) :
-      m_aggregatorNextID(0), m_semanticRootNamespace(semRootNs), m_aggregatorRootNamespace(aggregRootNs), m_semAggregatorQuickList(NULL)  {}
+      m_aggregatorNextID(0), m_semanticRootNamespace(semRootNs), m_aggregatorRootNamespace(aggregRootNs), m_semAggregatorQuickList(NULL), m_dispatch(NULL),
+      m_shardList(NULL), m_shardKey(QualExprThreadCache<QualExprSemanticAggregatorDB>::newOwnerKey()), m_shardLock(), m_nextDB(NULL)  { linkDB(); }
 
     /* Destructor */ ~QualExprSemanticAggregatorDB(void);
 
+    static void			   	releaseThread(void *marker);									//!< Retire the shards and replicas of a terminated thread.
+
   public: // -- Access API
     void   	display(const std::string &indent, std::stringstream &s) const; //!< Display the full namespace description.
 
@@ -57,11 +77,55 @@ namespace quality_expressions_core
     void			   	resetMeasures(void);										//!< Reset to the neutral value all aggregators.
     void			   	clearMeasures(void);										//!< Remove all semantic aggregator.
     void			   	consolidate(void) throw();									//!< If possible improve data structures to speed-up event evaluations.
-    void			   	evaluateEvent(const QualExprEvent &event) throw();						//!< Update semantic aggregators with event properties.
+    void			   	evaluateEvent(const QualExprEvent &event) throw()						{ evaluateEvents(&event, 1); }	//!< Update semantic aggregators with event properties.
+    void			   	evaluateEvents(const QualExprEvent *events, size_t count) throw();				//!< Update semantic aggregators with a batch of events.
 
   private:
     void			   	cacheAggregators(void);										//!< Cache the current list of aggregators.
     void			   	cleanAggregatorCache(void);									//!< Clear the aggregator cache.
+    void				retireThread(pthread_t owner);									//!< Free the shard and retire the replicas of a terminated thread.
+    void				linkDB(void);											//!< Record the database in the list of databases alive.
+
+  private:
+    enum { LANE_RUN = 64 };												//!< Maximum number of events of a run sampled at once.
+
+    /** @brief Aggregator replicas of a thread, pushed on the list head. */
+    typedef struct shard_t {
+      pthread_t				m_owner;				//!< Thread owning the shard.
+      QualExprAggregator **		m_replicas;				//!< Thread replicas, in the order of the aggregator cache.
+      QualExprLanes *			m_lanes;				//!< State of the replicas with a lane, in the order of the dispatch lanes.
+      struct shard_t *			m_next;					//!< Next shard.
+    } shard_t;
+
+    /** @brief Dense block of semantic IDs in the dispatch index. */
+    typedef struct dispatchBlock_t {
+      unsigned int			m_base;					//!< First semantic ID of the block.
+      unsigned int			m_size;					//!< Number of semantic IDs in the block.
+      size_t				m_offset;				//!< Position of the block in the span offsets.
+    } dispatchBlock_t;
+
+    /** @brief Consecutive lanes of a semantic ID accumulating the values of the same source. */
+    typedef struct laneGroup_t {
+      unsigned int			m_source;				//!< Aggregator index sampling the values of the source.
+      QualExprAggregator::lane_t	m_lane;					//!< Accumulation of the lanes.
+      unsigned int			m_begin;				//!< First lane.
+      unsigned int			m_end;					//!< Lane after the last one.
+    } laneGroup_t;
+
+    /** @brief Semantic ID to aggregator spans index, in compressed rows. */
+    typedef struct dispatch_t {
+      std::vector<dispatchBlock_t>	m_blocks;				//!< Blocks of semantic IDs, sorted and disjoint.
+      std::vector<size_t>		m_offsets;				//!< Aggregator span of each semantic ID, m_size+1 entries per block.
+      std::vector<unsigned int>		m_aggregators;				//!< Aggregator indexes without lane, grouped by semantic ID.
+      std::vector<size_t>		m_groupOffsets;				//!< Lane group span of each semantic ID, as m_offsets.
+      std::vector<laneGroup_t>		m_groups;				//!< Lane groups, grouped by semantic ID then by source.
+      std::vector<unsigned int>		m_lanes;				//!< Aggregator index of each lane.
+      std::vector<unsigned int>		m_unranged;				//!< Aggregators without semantic range, filtered by matchSemantic().
+    } dispatch_t;
+
+    dispatch_t *			buildDispatch(QualExprSemanticAggregator **quickList) const;	//!< Build the dispatch index of an aggregator list.
+    shard_t *				threadShard(void);						//!< Return the shard of the calling thread.
+    void				releaseShard(shard_t *shard);					//!< Move the lanes back in the replicas and free a shard.
 
   private:
     size_t						m_aggregatorNextID;			//!< Next aggregator ID, strictly growing, it is unique.
@@ -69,6 +133,13 @@ namespace quality_expressions_core
     QualExprAggregatorNamespace &			m_aggregatorRootNamespace;		//!< Reference to the root namespace of aggregators.
     std::vector<class QualExprSemanticAggregator *>	m_semAggregatorList;			//!< List of all active semantic aggregators.
     QualExprSemanticAggregator **			m_semAggregatorQuickList;		//!< Temporary List of all active semantic aggregators.
+    dispatch_t *					m_dispatch;				//!< Semantic ID dispatch index, built with the aggregator cache.
+    shard_t *						m_shardList;				//!< Lock-free list of thread shards.
+    unsigned long					m_shardKey;				//!< Thread cache owner key, renewed with the aggregator cache.
+    QualExprSemaphore					m_shardLock;				//!< Protects the shard and aggregator lists against thread terminations.
+    QualExprSemanticAggregatorDB *			m_nextDB;				//!< Next database alive.
+
+    static QualExprSemanticAggregatorDB *		g_dbList;				//!< Databases alive, protected by g_dbListLock.
   };
 
 }
@@ -18,6 +18,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
@@ -26,7 +27,47 @@
 
 namespace quality_expressions_core
 {
-  clockid_t QualExprTimerStdUnix::m_start_clock_id = 1;
+  /** @brief Build the timer selected in the environment.
+      The time stamp counter is only used if it is invariant, the monotonic clock is used otherwise.
+      @sa QUALEXPR_TIMER_ENVNAME
+  */
+  QualExprTimer * QualExprTimer::buildFromEnvironment(void)
+  {
+    const char *env = getenv(QUALEXPR_TIMER_ENVNAME);
+    if (env && !strcmp(env, "tsc") && QualExprTimerTSC::isAvailable()) return new QualExprTimerTSC();
+    if (env && !strcmp(env, "systime")) return new QualExprTimerStdSysTime();
+    return new QualExprTimerStdUnix();
+  }
+
+  /** @brief Calibrate the counter period over about 10 milliseconds of the monotonic clock.
+   */
+  /* Constructor */ QualExprTimerTSC::QualExprTimerTSC(void) :
+    m_origin(0), m_scale(0)
+  {
+    QualExprTimerStdUnix clock;
+    qualexpr_time_t start = clock.timestamp();
+    unsigned long long counterStart = readCounter();
+    qualexpr_time_t stop;
+    do { stop = clock.timestamp(); } while (stop - start < 10000000LL);
+    unsigned long long counterStop = readCounter();
+    m_scale = (unsigned long long) (stop - start) * (1ULL << SCALE_SHIFT) / (counterStop - counterStart);
+    m_origin = readCounter();
+  }
+
+  /** @brief Check the invariant time stamp counter flag (CPUID leaf 0x80000007, EDX bit 8).
+   */
+  bool QualExprTimerTSC::isAvailable(void)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    __asm__ __volatile__ ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (0x80000000));
+    if (eax < 0x80000007) return false;
+    __asm__ __volatile__ ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (0x80000007));
+    return (edx & (1 << 8)) != 0;
+#else
+    return false;
+#endif
+  }
 
   void QualExprEvent::display(const std::string &indent, std::stringstream &s) const
   {
@@ -61,4 +102,113 @@ namespace quality_expressions_core
   void QualExprEventBuilder::popEventSequence_singleThread(const QualExprEvent &event)
   {}
 
+  /** @brief Event descriptors of a thread, released by the storage key destructor when the thread terminates.
+   */
+  typedef struct threadStorage_t {
+    QualExprEvent *		m_event;		//!< Single event descriptor.
+    QualExprEvent *		m_events;		//!< Batch of event descriptors.
+    size_t			m_eventsSize;		//!< Number of descriptors of the batch.
+  } threadStorage_t;
+
+  static __thread threadStorage_t *g_threadStorage = NULL;	//!< Event descriptors of the calling thread.
+  static pthread_key_t g_threadStorageKey;			//!< Key releasing the event descriptors of terminated threads.
+  static pthread_once_t g_threadStorageOnce = PTHREAD_ONCE_INIT;
+
+  static void createThreadStorageKey(void)
+  {
+    pthread_key_create(&g_threadStorageKey, QualExprEventBuilder::releaseThreadStorage);
+  }
+
+  /** @brief Return the event descriptors of the calling thread, registered on the first event of the thread.
+   */
+  static threadStorage_t &threadStorage(void)
+  {
+    if (g_threadStorage) return *g_threadStorage;
+    pthread_once(&g_threadStorageOnce, createThreadStorageKey);
+    threadStorage_t *storage = new threadStorage_t;
+    storage->m_event = NULL;
+    storage->m_events = NULL;
+    storage->m_eventsSize = 0;
+    pthread_setspecific(g_threadStorageKey, storage);
+    g_threadStorage = storage;
+    return *storage;
+  }
+
+  /** @brief Thread termination: release the event descriptors of the thread.
+   */
+  void QualExprEventBuilder::releaseThreadStorage(void *data)
+  {
+    threadStorage_t *storage = (threadStorage_t *) data;
+    delete storage->m_event;
+    delete[] storage->m_events;
+    delete storage;
+    g_threadStorage = NULL;
+  }
+
+  const QualExprEvent & QualExprEventBuilder::pushEvent_threadLocal(profiling_event_t * event, unsigned long context)
+  {
+    threadStorage_t &storage = threadStorage();
+    QualExprEvent *qeEvent = storage.m_event;
+    if (!qeEvent) {
+      qeEvent = storage.m_event = new QualExprEvent();
+    }
+    qeEvent->m_state = event->m_state;
+    qeEvent->m_semanticId = event->m_semanticId;
+    qeEvent->m_timestamp = m_timer.timestamp();
+    qeEvent->m_value = event->m_value;
+    qeEvent->m_eid = event->m_eid;
+    qeEvent->m_context = context;
+    return *qeEvent;
+  }
+
+  void QualExprEventBuilder::popEventSequence_threadLocal(const QualExprEvent &event)
+  {}
+
+  /** @brief Grow the thread local batch of event descriptors.
+   */
+  QualExprEvent * QualExprEventBuilder::threadEvents(size_t count)
+  {
+    threadStorage_t &storage = threadStorage();
+    if (storage.m_eventsSize < count) {
+      delete[] storage.m_events;
+      storage.m_events = new QualExprEvent[count];
+      storage.m_eventsSize = count;
+    }
+    return storage.m_events;
+  }
+
+  const QualExprEvent * QualExprEventBuilder::pushEvents_threadLocal(profiling_event_t * events, size_t count, unsigned long context)
+  {
+    QualExprEvent *qeEvents = threadEvents(count);
+    qualexpr_time_t timestamp = m_timer.timestamp();
+    for (size_t index = 0; index < count; index++) {
+      QualExprEvent &qeEvent = qeEvents[index];
+      qeEvent.m_state = events[index].m_state;
+      qeEvent.m_semanticId = events[index].m_semanticId;
+      qeEvent.m_timestamp = timestamp;
+      qeEvent.m_value = events[index].m_value;
+      qeEvent.m_eid = events[index].m_eid;
+      qeEvent.m_context = context;
+    }
+    return qeEvents;
+  }
+
+  const QualExprEvent * QualExprEventBuilder::pushRecords_threadLocal(const QualExprEventRecord * records, size_t count)
+  {
+    QualExprEvent *qeEvents = threadEvents(count);
+    for (size_t index = 0; index < count; index++) {
+      QualExprEvent &qeEvent = qeEvents[index];
+      qeEvent.m_state = records[index].m_event.m_state;
+      qeEvent.m_semanticId = records[index].m_event.m_semanticId;
+      qeEvent.m_timestamp = records[index].m_timestamp;
+      qeEvent.m_value = records[index].m_event.m_value;
+      qeEvent.m_eid = records[index].m_event.m_eid;
+      qeEvent.m_context = records[index].m_context;
+    }
+    return qeEvents;
+  }
+
+  void QualExprEventBuilder::popEventsSequence_threadLocal(const QualExprEvent *events, size_t count)
+  {}
+
 }
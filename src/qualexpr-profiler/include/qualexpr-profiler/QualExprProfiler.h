@@ -30,6 +30,8 @@
 
 namespace quality_expressions_core
 {
+  typedef long long qualexpr_time_t;	//!< Time stamp in nanoseconds.
+
   /**
      @class QualExprException
      @brief Basic interface for standard exceptions.
@@ -52,10 +54,13 @@ namespace quality_expressions_core
   {
   protected:
     /* Constructor */ QualExprTimer(void) {}
-    /* Constructor */ virtual ~QualExprTimer(void) {}
 
   public:
-    virtual double	timestamp(void) = 0;
+    /* Destructor */ virtual ~QualExprTimer(void) {}
+
+    virtual qualexpr_time_t	timestamp(void) = 0;			//!< Return the current time in nanoseconds.
+
+    static QualExprTimer *	buildFromEnvironment(void);		//!< Build the timer selected in the environment.
   };
 
   /* ---------------------------------------------------------------------------------------------------------------- */
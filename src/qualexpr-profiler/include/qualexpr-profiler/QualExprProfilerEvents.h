@@ -33,21 +33,34 @@ namespace quality_expressions_core
   {
   protected:
     friend class QualExprEventBuilder;
-    /* Constructor */ QualExprEvent(void) {}
+    /* Constructor */ QualExprEvent(void) : m_context(NoContext) {}
     /* Constructor */ QualExprEvent(event_state_t state, unsigned int semanticId) :
-      m_timestamp(0), m_value(0), m_state(state), m_eid(0), m_semanticId(semanticId) {}
+      m_timestamp(0), m_value(0), m_state(state), m_eid(0), m_semanticId(semanticId), m_context(NoContext) {}
     /* Destructor */ virtual ~QualExprEvent(void) {}
 
   public:
-    double			m_timestamp;		//!< Time stamp of the event.
+    static const unsigned long	NoContext = ~0UL;	//!< Context of events sent to all evaluation contexts.
+
+    qualexpr_time_t		m_timestamp;		//!< Time stamp of the event in nanoseconds.
     long long			m_value;		//!< Value of the counter or event (size, count, ...).
     event_state_t		m_state;		//!< Event state (start/stop/wait).
     unsigned int		m_eid;			//!< Event unique ID - mandatory for intealeaved events.
     unsigned int		m_semanticId;		//!< Event semantic ID - defined globally.
+    unsigned long		m_context;		//!< Evaluation context of the producer, NoContext if none is active.
 
     virtual void display(const std::string &indent, std::stringstream &s) const;
   };
 
+  /**
+     @brief Event recorded for a deferred evaluation.
+     @ingroup QualityExpressionProfilerInternal
+  */
+  typedef struct QualExprEventRecord {
+    profiling_event_t		m_event;		//!< The profiler event.
+    qualexpr_time_t		m_timestamp;		//!< Time stamp taken when the event was recorded.
+    unsigned long		m_context;		//!< Evaluation context of the producer.
+  } QualExprEventRecord;
+
   /**
      @class QualExprEventBuilder
      @brief Basic class for the generation of event or counters objects.
@@ -72,6 +85,19 @@ namespace quality_expressions_core
     const QualExprEvent &	pushEvent_singleThread(profiling_event_t * event);		//!< Build and push a new event descriptor. Not thread safe.
     void			popEventSequence_singleThread(const QualExprEvent & event);	//!< Pop the event sequence. Not thread safe.
 
+    const QualExprEvent &	pushEvent_threadLocal(profiling_event_t * event, unsigned long context = QualExprEvent::NoContext);	//!< Build and push a new event descriptor in the calling thread storage.
+    void			popEventSequence_threadLocal(const QualExprEvent & event);	//!< Pop the event sequence of the calling thread.
+
+    const QualExprEvent *	pushEvents_threadLocal(profiling_event_t * events, size_t count, unsigned long context = QualExprEvent::NoContext);	//!< Build and push a batch of event descriptors sharing one time stamp, in the calling thread storage.
+    const QualExprEvent *	pushRecords_threadLocal(const QualExprEventRecord * records, size_t count);	//!< Build and push a batch of event descriptors from recorded events, in the calling thread storage.
+    void			popEventsSequence_threadLocal(const QualExprEvent * events, size_t count);	//!< Pop the event sequence of a batch of the calling thread.
+
+  protected:
+    static QualExprEvent *	threadEvents(size_t count);						//!< Return the batch storage of the calling thread, with at least count events.
+
+  public:
+    static void			releaseThreadStorage(void *storage);					//!< Release the event descriptors of a terminated thread.
+
   protected:
     QualExprTimer &				m_timer;		//!< Timestamp service. */
     QualExprEvent				m_event;		//!< For a faster thread safe service. */
@@ -28,10 +28,17 @@
 #include <string>
 
 #include "quality-expressions/QualityExpressionsProfiler.h"
+#include "quality-expressions/QualityExpressionsProfilerSystem.h"
 #include "qualexpr-profiler/QualExprProfilerSystem.h"
 
 namespace quality_expressions_core
 {
+  /** @def   QUALEXPR_TIMER_ENVNAME
+      @ingroup QualityExpressionProfilerInternal
+      @brief Timer used to time stamp events: "unix" (default), "tsc" or "systime".
+  */
+#define QUALEXPR_TIMER_ENVNAME "QUALITY_EXPRESSION_TIMER"
+
   /**
      @class QualExprTimerStdSysTime
      @brief Provide the standard POSIX timestamp.
@@ -43,12 +50,12 @@ namespace quality_expressions_core
     /* Constructor */ QualExprTimerStdSysTime(void) {}
     /* Constructor */ virtual ~QualExprTimerStdSysTime(void) {}
 
-    virtual double	timestamp(void) {
+    virtual qualexpr_time_t	timestamp(void) {
       struct timeval chrono;
       struct timezone tz;
 
       gettimeofday (&chrono, &tz);
-      double chrono_value = chrono.tv_sec + chrono.tv_usec/1000000.0;
+      qualexpr_time_t chrono_value = (qualexpr_time_t) chrono.tv_sec * 1000000000LL + (qualexpr_time_t) chrono.tv_usec * 1000LL;
       return chrono_value;
     }
   };
@@ -57,28 +64,105 @@ namespace quality_expressions_core
      @class QualExprTimerStdUnix
      @brief Provide the standard Unix timestamp.
      @ingroup QualityExpressionProfilerInternal
+
+     Time stamps are read from the monotonic clock, relative to the construction of the timer.
   */
   class QualExprTimerStdUnix : public QualExprTimer
   {
-  public:	/* WARNING ! The Contructor is not THREAD SAFE ! */
-    /* Constructor */ QualExprTimerStdUnix(void) : m_clock_id(m_start_clock_id) {
-      m_start_clock_id ++;
-      struct timespec tp;
-      tp.tv_sec = 0; tp.tv_nsec = 0;
-      /* int error =*/ clock_settime(m_clock_id, &tp);
+  public:
+    /* Constructor */ QualExprTimerStdUnix(void) : m_origin(0) {
+      m_origin = timestamp();
     }
     /* Constructor */ virtual ~QualExprTimerStdUnix(void) {}
 
-    virtual double	timestamp(void) {
+    virtual qualexpr_time_t	timestamp(void) {
       struct timespec tp;
-      /*int error =*/ clock_gettime(m_clock_id, &tp);
-      return (double ) (tp.tv_sec)  + (double) (tp.tv_nsec) / 1e9 ;
+      /*int error =*/ clock_gettime(CLOCK_MONOTONIC, &tp);
+      return (qualexpr_time_t) tp.tv_sec * 1000000000LL + (qualexpr_time_t) tp.tv_nsec - m_origin;
     }
 
-    static clockid_t	m_start_clock_id;
-    clockid_t		m_clock_id;
+  private:
+    qualexpr_time_t	m_origin;		//!< Clock value at the construction.
   };
 
+  /**
+     @class QualExprTimerTSC
+     @brief Provide a timestamp read from the time stamp counter of the processor.
+     @ingroup QualityExpressionProfilerInternal
+
+     The counter frequency is calibrated against the monotonic clock at the construction.
+     The timer is only valid if the processor provides an invariant counter, see isAvailable().
+     Ticks are converted to nanoseconds with a fixed point scale: ns = ticks * m_scale / 2^SCALE_SHIFT.
+  */
+  class QualExprTimerTSC : public QualExprTimer
+  {
+  public:
+    /* Constructor */ QualExprTimerTSC(void);
+    /* Constructor */ virtual ~QualExprTimerTSC(void) {}
+
+    virtual qualexpr_time_t	timestamp(void)	{
+      unsigned long long ticks = readCounter() - m_origin;
+      return (qualexpr_time_t) ((((ticks >> 32) * m_scale) << (32 - SCALE_SHIFT)) + (((ticks & 0xFFFFFFFFULL) * m_scale) >> SCALE_SHIFT));
+    }
+
+    static bool		isAvailable(void);			//!< True if the time stamp counter is invariant.
+
+  private:
+    static unsigned long long	readCounter(void) {
+#if defined(__x86_64__) || defined(__i386__)
+      unsigned int low, high;
+      __asm__ __volatile__ ("rdtsc" : "=a" (low), "=d" (high));
+      return ((unsigned long long) high << 32) | low;
+#else
+      return 0;
+#endif
+    }
+
+  private:
+    enum { SCALE_SHIFT = 24 };			//!< Fixed point precision of the scale, ticks up to 256ns are supported.
+
+    unsigned long long	m_origin;		//!< Counter value at the construction.
+    unsigned long long	m_scale;		//!< Calibrated duration of a counter tick in nanoseconds, fixed point.
+  };
+
+  /**
+     @class QualExprThreadCache
+     @brief Per-thread direct mapped cache of pointers, indexed by an owner key and a local key.
+     @param tag  Any type, used to separate independent caches.
+     @param size Number of entries per thread.
+     @ingroup QualityExpressionProfilerInternal
+
+     Owner keys are unique application wide and never reused: renewing the owner key of an
+     object is enough to invalidate the entries recorded by all threads for that object.
+     A miss only means that the caller must fall back to its slow path.
+  */
+  template<class tag, size_t size = 64>
+  class QualExprThreadCache
+  {
+  public:
+    /** @brief Return the cached value, NULL if not found. */
+    static void *		find(unsigned long owner, unsigned long key)		{ const entry_t &e = g_entries[slot(owner, key)]; return (e.m_owner == owner && e.m_key == key) ? e.m_value : NULL; }
+    /** @brief Record a value for the calling thread. */
+    static void			store(unsigned long owner, unsigned long key, void *value)	{ entry_t &e = g_entries[slot(owner, key)]; e.m_owner = owner; e.m_key = key; e.m_value = value; }
+    /** @brief Return a new owner key, never 0. */
+    static unsigned long	newOwnerKey(void)					{ return atomic_add<unsigned long>(g_ownerCursor, 1); }
+
+  private:
+    typedef struct entry_t {
+      unsigned long		m_owner;		//!< Owner key, 0 if the entry is empty.
+      unsigned long		m_key;			//!< Local key.
+      void *			m_value;		//!< Cached value.
+    } entry_t;
+
+    static size_t		slot(unsigned long owner, unsigned long key)		{ return ((owner * 0x9E3779B1UL) ^ key) % size; }
+
+    static __thread entry_t	g_entries[size];	//!< Thread local entries.
+    static unsigned long	g_ownerCursor;		//!< Atomic counter for the generation of owner keys.
+  };
+
+  template<class tag, size_t size> __thread typename QualExprThreadCache<tag, size>::entry_t QualExprThreadCache<tag, size>::g_entries[size];
+  template<class tag, size_t size> unsigned long QualExprThreadCache<tag, size>::g_ownerCursor = 0;
+
 } // /quality_expressions
 
 #endif